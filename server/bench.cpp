@@ -0,0 +1,739 @@
+// Benchmarks for the route search engine.
+//
+// Build (from server/):
+//   g++ -std=c++17 -O2 bench.cpp -o bench -pthread
+// On Windows (MinGW-w64) add -lws2_32 as for server.cpp.
+//
+// Every result belongs to a group named after its inputs
+// ("shortest/5000x500000/stops5"), which stays the same between commits.
+// --json FILE writes one JSON line per result, and --compare FILE reads such
+// a file back and prints the change for every result found in both. Fixed
+// seeds make the checksums reproducible, so a changed checksum means changed
+// answers, not noise.
+
+#define FLIGHTFARE_NO_MAIN
+#include "server.cpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <random>
+
+// ------------------------ Allocation Counter ------------------------
+
+// Every replaceable operator new/delete goes through these two. They are
+// kept out of line so the compiler never sees free() applied to the result
+// of a (builtin) operator new, which -Wmismatched-new-delete reports.
+static atomic<long long> allocationCount{0};
+
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void *countedAlloc(size_t size, size_t align) noexcept {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    size = size ? size : 1;
+    if (align <= alignof(max_align_t)) return malloc(size);
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    return aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+}
+
+BENCH_NOINLINE void countedFree(void *p, size_t align) noexcept {
+#ifdef _WIN32
+    if (align > alignof(max_align_t)) return _aligned_free(p);
+#endif
+    (void)align;
+    free(p);
+}
+
+void *operator new(size_t size) {
+    if (void *p = countedAlloc(size, 0)) return p;
+    throw bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const nothrow_t &) noexcept { return countedAlloc(size, 0); }
+void *operator new[](size_t size, const nothrow_t &) noexcept { return countedAlloc(size, 0); }
+
+void *operator new(size_t size, align_val_t align) {
+    if (void *p = countedAlloc(size, (size_t)align)) return p;
+    throw bad_alloc();
+}
+void *operator new[](size_t size, align_val_t align) { return operator new(size, align); }
+void *operator new(size_t size, align_val_t align, const nothrow_t &) noexcept {
+    return countedAlloc(size, (size_t)align);
+}
+void *operator new[](size_t size, align_val_t align, const nothrow_t &) noexcept {
+    return countedAlloc(size, (size_t)align);
+}
+
+void operator delete(void *p) noexcept { countedFree(p, 0); }
+void operator delete[](void *p) noexcept { countedFree(p, 0); }
+void operator delete(void *p, size_t) noexcept { countedFree(p, 0); }
+void operator delete[](void *p, size_t) noexcept { countedFree(p, 0); }
+void operator delete(void *p, const nothrow_t &) noexcept { countedFree(p, 0); }
+void operator delete[](void *p, const nothrow_t &) noexcept { countedFree(p, 0); }
+
+void operator delete(void *p, align_val_t align) noexcept { countedFree(p, (size_t)align); }
+void operator delete[](void *p, align_val_t align) noexcept { countedFree(p, (size_t)align); }
+void operator delete(void *p, size_t, align_val_t align) noexcept { countedFree(p, (size_t)align); }
+void operator delete[](void *p, size_t, align_val_t align) noexcept { countedFree(p, (size_t)align); }
+void operator delete(void *p, align_val_t align, const nothrow_t &) noexcept {
+    countedFree(p, (size_t)align);
+}
+void operator delete[](void *p, align_val_t align, const nothrow_t &) noexcept {
+    countedFree(p, (size_t)align);
+}
+
+// ------------------------ Synthetic Networks ------------------------
+
+// Random network with `cities` vertices and roughly `legs` directed legs.
+// With skew 0 both ends of a leg are uniform; otherwise they follow a Zipf
+// law of that exponent over a shuffled city order, so a few hubs carry most
+// of the legs as in real airline networks.
+Graph makeNetwork(int cities, int legs, unsigned seed, double skew = 0) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> fare(1000, 9000);
+    uniform_int_distribution<int> uniform(0, cities - 1);
+    discrete_distribution<int> rank;
+    vector<int> order(cities);
+    if (skew > 0) {
+        iota(order.begin(), order.end(), 0);
+        shuffle(order.begin(), order.end(), rng);
+        vector<double> weights(cities);
+        for (int r = 0; r < cities; r++) weights[r] = 1 / pow(r + 1.0, skew);
+        rank = discrete_distribution<int>(weights.begin(), weights.end());
+    }
+    auto city = [&] { return skew > 0 ? order[rank(rng)] : uniform(rng); };
+
+    Graph net(cities);
+    for (int i = 0; i < legs; i++) {
+        int u = city(), v = city();
+        if (u != v) net.addEdge(u, v, fare(rng));
+    }
+    net.freeze();
+    return net;
+}
+
+// Group label for a synthetic network, e.g. "5000x500000" or "5000x50000zipf1.0"
+string networkLabel(int cities, int legs, double skew) {
+    ostringstream label;
+    label << cities << "x" << legs;
+    if (skew > 0) label << "zipf" << fixed << setprecision(1) << skew;
+    return label.str();
+}
+
+// The pre-CSR stop-limited Bellman-Ford that copied dist/parent every round.
+pair<int, vector<int>> copyingShortest(const Graph &net, int src, int dest, int maxStops) {
+    if (src == dest) return { 0, {src} };
+
+    vector<int> dist(net.V, INF), parent(net.V, -1);
+    dist[src] = 0;
+
+    for (int k = 0; k <= maxStops; k++) {
+        bool updated = false;
+        vector<int> newDist = dist;
+        vector<int> newParent = parent;
+
+        for (int u = 0; u < net.V; u++) {
+            if (dist[u] >= INF) continue;
+            for (int e = net.offsets[u]; e < net.offsets[u + 1]; e++) {
+                int v = net.edgeTo[e];
+                if (dist[u] + net.edgeCost[e] < newDist[v]) {
+                    newDist[v] = dist[u] + net.edgeCost[e];
+                    newParent[v] = u;
+                    updated = true;
+                }
+            }
+        }
+
+        dist = newDist;
+        parent = newParent;
+        if (!updated) break;
+    }
+
+    if (dist[dest] >= INF) return { -1, {} };
+    vector<int> path;
+    for (int v = dest; v != -1; v = parent[v]) path.push_back(v);
+    reverse(path.begin(), path.end());
+    return { dist[dest], path };
+}
+
+// The original best-first findMultipleRoutes that copied the path into every
+// queue entry and kept one route per distinct cost.
+vector<Route> copyingMultipleRoutes(const Graph &net, int src, int dest, int maxStops, int maxResults) {
+    if (src == dest) return { {0, {src}, 0} };
+
+    priority_queue<tuple<int, int, vector<int>, int>,
+                   vector<tuple<int, int, vector<int>, int>>,
+                   greater<tuple<int, int, vector<int>, int>>> pq;
+    pq.push({0, src, {src}, 0});
+
+    vector<Route> results;
+    set<int> visitedCosts;
+    while (!pq.empty() && (int)results.size() < maxResults) {
+        auto [cost, node, path, stops] = pq.top();
+        pq.pop();
+        if (node == dest) {
+            if (visitedCosts.insert(cost).second) results.push_back({cost, path, stops});
+            continue;
+        }
+        if (stops >= maxStops) continue;
+        for (int e = net.offsets[node]; e < net.offsets[node + 1]; e++) {
+            int next = net.edgeTo[e];
+            if (find(path.begin(), path.end(), next) != path.end()) continue;
+            vector<int> newPath = path;
+            newPath.push_back(next);
+            pq.push({cost + net.edgeCost[e], next, newPath, stops + 1});
+        }
+    }
+    return results;
+}
+
+// The original full-matrix Levenshtein and the suggestCities scan built on it
+int matrixLevenshtein(const string &a, const string &b) {
+    int n = a.size(), m = b.size();
+    if (n == 0) return m;
+    if (m == 0) return n;
+    vector<vector<int>> dp(n + 1, vector<int>(m + 1));
+    for (int i = 0; i <= n; i++) dp[i][0] = i;
+    for (int j = 0; j <= m; j++) dp[0][j] = j;
+    for (int i = 1; i <= n; i++) {
+        for (int j = 1; j <= m; j++) {
+            dp[i][j] = (a[i - 1] == b[j - 1])
+                           ? dp[i - 1][j - 1]
+                           : 1 + min({ dp[i - 1][j], dp[i][j - 1], dp[i - 1][j - 1] });
+        }
+    }
+    return dp[n][m];
+}
+
+vector<string> matrixSuggestCities(const string &wrong, const vector<string> &cities) {
+    vector<pair<int, string>> scores;
+    string wrongLower = toLowerCase(wrong);
+    for (const auto &c : cities) {
+        int dist = matrixLevenshtein(wrongLower, toLowerCase(c));
+        if (dist <= 3) scores.push_back({ dist, c });
+    }
+    sort(scores.begin(), scores.end());
+    vector<string> result;
+    for (int i = 0; i < min(3, (int)scores.size()); i++) result.push_back(scores[i].second);
+    return result;
+}
+
+// Capitalized pseudo-words of 4-14 letters
+vector<string> makeCityNames(int count, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> length(4, 14), letter(0, 25);
+    vector<string> names;
+    for (int i = 0; i < count; i++) {
+        string name;
+        for (int n = length(rng); n > 0; n--) name += char('a' + letter(rng));
+        name[0] = toupper(name[0]);
+        names.push_back(name);
+    }
+    return names;
+}
+
+// Copies of random names with one or two random single-letter edits
+vector<string> makeTypos(const vector<string> &names, int count, unsigned seed) {
+    mt19937 rng(seed);
+    vector<string> typos;
+    for (int i = 0; i < count; i++) {
+        string s = names[rng() % names.size()];
+        for (int e = 1 + rng() % 2; e > 0; e--) {
+            size_t at = rng() % s.size();
+            switch (rng() % 3) {
+                case 0: s[at] = char('a' + rng() % 26); break;
+                case 1: s.insert(s.begin() + at, char('a' + rng() % 26)); break;
+                default: if (s.size() > 1) s.erase(at, 1);
+            }
+        }
+        typos.push_back(s);
+    }
+    return typos;
+}
+
+// ------------------------ Harness ------------------------
+
+struct Query {
+    int src, dest, maxStops;
+};
+
+vector<Query> makeQueries(int cities, int count, int maxStops, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> city(0, cities - 1);
+    vector<Query> queries;
+    for (int i = 0; i < count; i++) {
+        queries.push_back({ city(rng), city(rng), maxStops });
+    }
+    return queries;
+}
+
+struct BenchResult {
+    string group, name;
+    long long iterations;
+    double usPerOp, allocsPerOp;
+    long long checksum;
+
+    string key() const { return group + " " + name; }
+};
+
+struct BenchOptions {
+    string filter;        // run only groups containing this
+    int repeat = 1;       // timed passes per benchmark, the fastest is kept
+    string jsonFile;
+    string compareFile;
+};
+
+BenchOptions benchOptions;
+vector<BenchResult> benchResults;
+string benchGroup;
+
+// Start a group of results; false when --filter excludes it
+bool beginGroup(const string &group) {
+    if (group.find(benchOptions.filter) == string::npos) return false;
+    benchGroup = group;
+    return true;
+}
+
+void record(const string &name, long long iterations, double usPerOp, double allocsPerOp, long long checksum) {
+    benchResults.push_back({ benchGroup, name, iterations, usPerOp, allocsPerOp, checksum });
+}
+
+void report(const string &name, long long iterations, double elapsedUs, long long allocs, long long checksum) {
+    record(name, iterations, elapsedUs / iterations, (double)allocs / iterations, checksum);
+    cout << left << setw(36) << name
+         << right << setw(12) << fixed << setprecision(2) << elapsedUs / iterations << " us/query"
+         << setw(12) << setprecision(2) << (double)allocs / iterations << " allocs/query"
+         << "   checksum " << checksum << endl;
+}
+
+template <typename Fn>
+void runBenchmark(const string &name, const vector<Query> &queries, Fn search) {
+    search(queries[0]); // warm-up
+
+    long long checksum = 0, allocs = 0;
+    double best = numeric_limits<double>::infinity();
+    for (int pass = 0; pass < benchOptions.repeat; pass++) {
+        long long sum = 0;
+        long long allocsBefore = allocationCount.load();
+        auto start = chrono::steady_clock::now();
+        for (const auto &q : queries) sum += search(q);
+        best = min(best, chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        allocs = allocationCount.load() - allocsBefore;
+        checksum = sum;
+    }
+    report(name, queries.size(), best, allocs, checksum);
+}
+
+void writeResults(const string &path) {
+    ofstream out(path);
+    if (!out) throw runtime_error("cannot write " + path);
+    for (const auto &r : benchResults) {
+        json line = {
+            {"group", r.group}, {"name", r.name}, {"iterations", r.iterations},
+            {"us_per_op", r.usPerOp}, {"allocs_per_op", r.allocsPerOp}, {"checksum", r.checksum}
+        };
+        out << line.dump() << "\n";
+    }
+}
+
+// Side-by-side with an earlier --json file. Time deltas under a few percent
+// are usually noise; a checksum change never is.
+void compareResults(const string &path) {
+    ifstream in(path);
+    if (!in) throw runtime_error("cannot open " + path);
+    unordered_map<string, BenchResult> baseline;
+    string line;
+    while (getline(in, line)) {
+        json r = json::parse(line, nullptr, false);
+        if (!r.is_object() || !r.contains("group") || !r.contains("name")) continue;
+        BenchResult b{ r["group"], r["name"], r.value("iterations", 0LL), r.value("us_per_op", 0.0),
+                       r.value("allocs_per_op", 0.0), r.value("checksum", 0LL) };
+        baseline[b.key()] = b;
+    }
+
+    cout << "\ncompared with " << path << endl;
+    int matched = 0;
+    for (const auto &r : benchResults) {
+        auto it = baseline.find(r.key());
+        if (it == baseline.end()) continue;
+        const BenchResult &b = it->second;
+        matched++;
+        double change = b.usPerOp > 0 ? (r.usPerOp / b.usPerOp - 1) * 100 : 0;
+        cout << left << setw(64) << r.key()
+             << right << setw(12) << fixed << setprecision(2) << b.usPerOp << " ->"
+             << setw(12) << r.usPerOp << " us" << setw(9) << showpos << setprecision(1) << change << "%"
+             << noshowpos;
+        if (llround(r.allocsPerOp * 100) != llround(b.allocsPerOp * 100)) {  // as printed
+            cout << "   allocs " << setprecision(2) << b.allocsPerOp << " -> " << r.allocsPerOp;
+        }
+        if (r.checksum != b.checksum) cout << "   CHECKSUM " << b.checksum << " -> " << r.checksum;
+        cout << endl;
+    }
+    cout << matched << " of " << benchResults.size() << " results found in the baseline" << endl;
+}
+
+void benchShortest(int cities, int legs, int maxStops, int queryCount, double skew = 0) {
+    if (!beginGroup("shortest/" + networkLabel(cities, legs, skew) + "/stops" + to_string(maxStops))) return;
+    Graph net = makeNetwork(cities, legs, 42, skew);
+    auto queries = makeQueries(cities, queryCount, maxStops, 7);
+
+    cout << "\nshortest: " << cities << " cities, " << net.edgeCount()
+         << (skew > 0 ? " hub" : "") << " legs, maxStops " << maxStops << ", " << queryCount << " queries" << endl;
+
+    // Only the fare is summed so that path reconstruction is not timed twice.
+    runBenchmark("copying Bellman-Ford", queries, [&](const Query &q) {
+        return (long long)copyingShortest(net, q.src, q.dest, q.maxStops).first;
+    });
+    runBenchmark("Graph::shortest", queries, [&](const Query &q) {
+        return (long long)net.shortest(q.src, q.dest, q.maxStops).first;
+    });
+}
+
+void benchMultipleRoutes(int cities, int legs, int maxStops, int k, int queryCount, double skew = 0) {
+    if (!beginGroup("findMultipleRoutes/" + networkLabel(cities, legs, skew) + "/stops" + to_string(maxStops) +
+                    "/k" + to_string(k))) {
+        return;
+    }
+    Graph net = makeNetwork(cities, legs, 42, skew);
+    auto queries = makeQueries(cities, queryCount, maxStops, 7);
+
+    cout << "\nfindMultipleRoutes: " << cities << " cities, " << net.edgeCount()
+         << (skew > 0 ? " hub" : "") << " legs, maxStops " << maxStops << ", k " << k << ", "
+         << queryCount << " queries" << endl;
+
+    // Around hubs the copying queue grows to millions of labels per query
+    if (skew == 0) {
+        runBenchmark("copying best-first search", queries, [&](const Query &q) {
+            long long sum = 0;
+            for (const auto &r : copyingMultipleRoutes(net, q.src, q.dest, q.maxStops, k)) sum += r.cost;
+            return sum;
+        });
+    }
+    runBenchmark("Graph::findMultipleRoutes (Yen)", queries, [&](const Query &q) {
+        long long sum = 0;
+        for (const auto &r : net.findMultipleRoutes(q.src, q.dest, q.maxStops, k)) sum += r.cost;
+        return sum;
+    });
+}
+
+void benchFareTable(int cities, int legs, int maxStops, int queryCount) {
+    if (!beginGroup("fareTable/" + networkLabel(cities, legs, 0) + "/stops" + to_string(maxStops))) return;
+    Graph net = makeNetwork(cities, legs, 42);
+    auto queries = makeQueries(cities, queryCount, maxStops, 7);
+
+    auto start = chrono::steady_clock::now();
+    FareTable table;
+    table.build(net, maxStops);
+    auto buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    record("FareTable::build", 1, buildMs * 1000, 0, table.entries.size());
+
+    cout << "\nfare table: " << cities << " cities, " << net.edgeCount() << " legs, maxStops "
+         << maxStops << ", built in " << fixed << setprecision(0) << buildMs << " ms, "
+         << setprecision(1) << table.memoryBytes() / (1024.0 * 1024.0) << " MB" << endl;
+
+    runBenchmark("Graph::shortest", queries, [&](const Query &q) {
+        return (long long)net.shortest(q.src, q.dest, q.maxStops).first;
+    });
+    runBenchmark("FareTable::route", queries, [&](const Query &q) {
+        return (long long)table.route(q.src, q.dest, q.maxStops).first;
+    });
+}
+
+// Multi-source precompute throughput as workers are added
+void benchPrecompute(int cities, int legs, int maxStops) {
+    if (!beginGroup("precompute/" + networkLabel(cities, legs, 0) + "/stops" + to_string(maxStops))) return;
+    Graph net = makeNetwork(cities, legs, 42);
+    cout << "\nprecompute: " << cities << " cities, " << net.edgeCount() << " legs, maxStops "
+         << maxStops << ", " << workerCount() << " hardware threads" << endl;
+    for (int workers = 1; workers <= workerCount(); workers *= 2) {
+        auto start = chrono::steady_clock::now();
+        FareTable table;
+        table.build(net, maxStops, workers);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        record("FareTable::build/workers" + to_string(workers), cities, seconds * 1e6 / cities, 0,
+               table.entries.size());
+        cout << left << setw(36) << ("FareTable::build, " + to_string(workers) + " workers")
+             << right << setw(12) << fixed << setprecision(0) << cities / seconds << " sources/s" << endl;
+    }
+}
+
+// Aggregator-style batch: many destinations per origin
+void benchBatch(int cities, int legs, int sources, int queryCount) {
+    if (!beginGroup("batch/" + networkLabel(cities, legs, 0) + "/sources" + to_string(sources))) return;
+    Network net;
+    net.graph = makeNetwork(cities, legs, 42);
+    mt19937 rng(7);
+    vector<BatchQuery> batch(queryCount);
+    vector<Query> queries;
+    for (int i = 0; i < queryCount; i++) {
+        batch[i].src = rng() % sources;
+        batch[i].dest = sources + rng() % (cities - sources);
+        batch[i].stops = 3;
+        queries.push_back({ batch[i].src, batch[i].dest, batch[i].stops });
+    }
+
+    cout << "\nbatch search: " << cities << " cities, " << net.graph.edgeCount() << " legs, "
+         << queryCount << " queries from " << sources << " sources" << endl;
+    runBenchmark("Graph::shortest per query", queries, [&](const Query &q) {
+        return (long long)net.graph.shortest(q.src, q.dest, q.maxStops).first;
+    });
+
+    long long checksum = 0;
+    long long allocsBefore = allocationCount.load();
+    auto start = chrono::steady_clock::now();
+    for (const auto &result : searchBatch(net, batch)) checksum += result.first;
+    auto elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    long long allocs = allocationCount.load() - allocsBefore;
+    report("searchBatch", queryCount, elapsed, allocs, checksum);
+}
+
+// Distances between a misspelled name and a random one; both
+// implementations must sum to the same checksum
+void benchLevenshtein(int nameCount, int queryCount) {
+    if (!beginGroup("levenshtein/names" + to_string(nameCount))) return;
+    auto names = makeCityNames(nameCount, 42);
+    auto typos = makeTypos(names, queryCount, 7);
+    mt19937 rng(11);
+    vector<Query> queries;
+    for (int i = 0; i < queryCount; i++) queries.push_back({ i, (int)(rng() % names.size()), 0 });
+
+    cout << "\nlevenshtein: " << queryCount << " pairs of names" << endl;
+    runBenchmark("matrix Levenshtein", queries, [&](const Query &q) {
+        return (long long)matrixLevenshtein(typos[q.src], names[q.dest]);
+    });
+    runBenchmark("levenshtein", queries, [&](const Query &q) {
+        return (long long)levenshtein(typos[q.src], names[q.dest]);
+    });
+}
+
+void benchSuggestions(int nameCount, int queryCount) {
+    if (!beginGroup("suggestCities/names" + to_string(nameCount))) return;
+    auto names = makeCityNames(nameCount, 42);
+    auto typos = makeTypos(names, queryCount, 7);
+    vector<Query> queries;
+    for (int i = 0; i < queryCount; i++) queries.push_back({ i, 0, 0 });
+
+    cout << "\nsuggestCities: " << nameCount << " names, " << queryCount << " misspelled queries" << endl;
+
+    runBenchmark("matrix Levenshtein scan", queries, [&](const Query &q) {
+        return (long long)matrixSuggestCities(typos[q.src], names).size();
+    });
+    runBenchmark("suggestCities", queries, [&](const Query &q) {
+        return (long long)suggestCities(typos[q.src], names).size();
+    });
+
+    auto start = chrono::steady_clock::now();
+    SuggestionIndex index;
+    index.build(names, {});
+    auto buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    record("SuggestionIndex::build", 1, buildMs * 1000, 0, index.memoryBytes());
+    cout << "SuggestionIndex built in " << fixed << setprecision(0) << buildMs << " ms, "
+         << setprecision(1) << index.memoryBytes() / (1024.0 * 1024.0) << " MB" << endl;
+    runBenchmark("SuggestionIndex", queries, [&](const Query &q) {
+        return (long long)index.suggest(typos[q.src], names).size();
+    });
+}
+
+void benchAutocomplete(int nameCount, int queryCount) {
+    if (!beginGroup("autocomplete/names" + to_string(nameCount))) return;
+    auto names = makeCityNames(nameCount, 42);
+    Graph net = makeNetwork(nameCount, nameCount * 5, 42);
+
+    auto start = chrono::steady_clock::now();
+    AutocompleteIndex index;
+    index.build(names, net);
+    auto buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    record("AutocompleteIndex::build", 1, buildMs * 1000, 0, 0);
+
+    // Prefixes of 1-4 letters taken from real names
+    mt19937 rng(7);
+    vector<string> prefixes;
+    vector<Query> queries;
+    for (int i = 0; i < queryCount; i++) {
+        const string &name = names[rng() % names.size()];
+        prefixes.push_back(name.substr(0, 1 + rng() % 4));
+        queries.push_back({ i, 0, 0 });
+    }
+
+    cout << "\nautocomplete: " << nameCount << " names, built in " << fixed << setprecision(0)
+         << buildMs << " ms, " << queryCount << " prefix queries" << endl;
+    runBenchmark("AutocompleteIndex::complete", queries, [&](const Query &q) {
+        return (long long)index.complete(prefixes[q.src], MAX_AUTOCOMPLETE).size();
+    });
+}
+
+void benchCityLookup(int nameCount, int queryCount) {
+    if (!beginGroup("cityLookup/names" + to_string(nameCount))) return;
+    // Two-word names ("Navi Mumbai", "Sawai Madhopur"), often past the
+    // small-string buffer
+    auto words = makeCityNames(nameCount * 2, 42);
+    vector<string> names;
+    unordered_map<string, int> lowered;
+    CityMap cityMap;
+    for (int i = 0; i < nameCount; i++) {
+        names.push_back(words[2 * i] + " " + words[2 * i + 1]);
+        lowered.emplace(toLowerCase(names[i]), i);
+        cityMap.insert(names[i], i);
+    }
+
+    // Request-style strings: mixed case, padded, a few unknown
+    mt19937 rng(7);
+    vector<string> raw;
+    vector<Query> queries;
+    for (int i = 0; i < queryCount; i++) {
+        string name = names[rng() % names.size()];
+        for (auto &c : name) {
+            if (rng() % 2) c = (char)toupper((unsigned char)c);
+        }
+        if (i % 10 == 0) name += "q";
+        raw.push_back(" " + name + " ");
+        queries.push_back({ i, 0, 0 });
+    }
+
+    cout << "\ncity lookup: " << nameCount << " names, " << queryCount << " queries" << endl;
+    // What /search did per city: lowercase copy, count(), then at() per use
+    runBenchmark("toLowerCase + unordered_map", queries, [&](const Query &q) {
+        string key = toLowerCase(trim(raw[q.src]));
+        if (!lowered.count(key)) return -1LL;
+        return (long long)lowered.at(key) + lowered.at(key);
+    });
+    runBenchmark("CityMap::find", queries, [&](const Query &q) {
+        int id = cityMap.find(trimView(raw[q.src]));
+        return id < 0 ? -1LL : 2LL * id;
+    });
+}
+
+// The built-in 16-city network as the server loads it: every ordered pair of
+// cities, typos of every name, and the JSON the /search handler serializes
+void benchBuiltin(int maxStops, int k) {
+    if (!beginGroup("builtin/stops" + to_string(maxStops) + "/k" + to_string(k))) return;
+    auto net = loadNetwork(NetworkSource{});
+    const Graph &graph = net->graph;
+    vector<Query> pairs;
+    for (int src = 0; src < graph.V; src++) {
+        for (int dest = 0; dest < graph.V; dest++) pairs.push_back({ src, dest, maxStops });
+    }
+    auto typos = makeTypos(net->idToCity, 1000, 7);
+    vector<Query> typoQueries;
+    for (int i = 0; i < (int)typos.size(); i++) typoQueries.push_back({ i, 0, 0 });
+
+    cout << "\nbuilt-in network: " << graph.V << " cities, " << graph.edgeCount() << " legs, maxStops "
+         << maxStops << ", k " << k << ", " << pairs.size() << " city pairs" << endl;
+    runBenchmark("Graph::shortest", pairs, [&](const Query &q) {
+        return (long long)graph.shortest(q.src, q.dest, q.maxStops).first;
+    });
+    runBenchmark("Graph::findMultipleRoutes", pairs, [&](const Query &q) {
+        long long sum = 0;
+        for (const auto &r : graph.findMultipleRoutes(q.src, q.dest, q.maxStops, k)) sum += r.cost;
+        return sum;
+    });
+    runBenchmark("suggestCities", typoQueries, [&](const Query &q) {
+        return (long long)suggestCities(typos[q.src], net->idToCity).size();
+    });
+    runBenchmark("SuggestionIndex", typoQueries, [&](const Query &q) {
+        return (long long)net->suggestions.suggest(typos[q.src], net->idToCity).size();
+    });
+
+    // Serialization on its own, then the whole answer as handleSearch builds it
+    vector<json> responses(pairs.size());
+    vector<Query> responseQueries;
+    for (int i = 0; i < (int)pairs.size(); i++) {
+        runSearch(*net, pairs[i].src, pairs[i].dest, maxStops, true, k, {}, responses[i]);
+        responseQueries.push_back({ i, 0, 0 });
+    }
+    runBenchmark("json dump(2)", responseQueries, [&](const Query &q) {
+        return (long long)responses[q.src].dump(2).size();
+    });
+    runBenchmark("runSearch + dump(2)", pairs, [&](const Query &q) {
+        json response;
+        runSearch(*net, q.src, q.dest, q.maxStops, true, k, {}, response);
+        return (long long)response.dump(2).size();
+    });
+}
+
+void benchLoader(int cities, int legs) {
+    if (!beginGroup("loader/" + networkLabel(cities, legs, 0))) return;
+    string path = "bench_routes.csv";
+    {
+        mt19937 rng(42);
+        uniform_int_distribution<int> city(0, cities - 1);
+        uniform_int_distribution<int> fare(1000, 9000);
+        ofstream out(path);
+        out << "origin,destination,fare,oneway\n";
+        for (int i = 0; i < legs; i++) {
+            out << "City " << city(rng) << ",City " << city(rng) << "," << fare(rng) << ",1\n";
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    auto loaded = loadRoutesFile(path);
+    auto ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    remove(path.c_str());
+    record("loadRoutesFile", legs, ms * 1000 / legs, 0, loaded->graph.edgeCount());
+
+    cout << "\nloadRoutesFile: " << legs << " legs over " << cities << " cities in "
+         << fixed << setprecision(0) << ms << " ms" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            benchOptions.filter = argv[++i];
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            benchOptions.repeat = max(atoi(argv[++i]), 1);
+        } else if (arg == "--json" && i + 1 < argc) {
+            benchOptions.jsonFile = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            benchOptions.compareFile = argv[++i];
+        } else {
+            cerr << "usage: bench [--filter TEXT] [--repeat N] [--json FILE] [--compare FILE]" << endl;
+            return 2;
+        }
+    }
+
+    benchShortest(5000, 500000, 5, 100);
+    benchShortest(5000, 500000, MAX_STOPS_LIMIT, 20);
+    benchShortest(20000, 200000, 10, 100);
+    // Sparse continental network where most answers need only a few stops
+    benchShortest(5000, 20000, 2, 1000);
+    // Hub-and-spoke network with Zipf-distributed degrees
+    benchShortest(5000, 50000, 3, 1000, 1.0);
+
+    benchMultipleRoutes(2000, 8000, 4, 3, 50);
+    benchMultipleRoutes(5000, 50000, 5, 20, 20);
+    benchMultipleRoutes(2000, 8000, 4, 3, 50, 1.0);
+
+    benchFareTable(2000, 20000, 5, 10000);
+    benchPrecompute(2000, 20000, 5);
+
+    benchBatch(20000, 200000, 50, 5000);
+
+    benchLevenshtein(50000, 100000);
+    benchSuggestions(50000, 50);
+
+    benchAutocomplete(100000, 10000);
+
+    benchCityLookup(100000, 100000);
+
+    benchBuiltin(3, 5);
+
+    benchLoader(4000, 2000000);
+
+    try {
+        if (!benchOptions.jsonFile.empty()) writeResults(benchOptions.jsonFile);
+        if (!benchOptions.compareFile.empty()) compareResults(benchOptions.compareFile);
+    } catch (const exception &e) {
+        cerr << "✗ " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
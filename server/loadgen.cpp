@@ -0,0 +1,232 @@
+// Replays a JSON Lines capture of /search bodies against a running server,
+// or in-process against handleSearch, and reports throughput and latency.
+//
+// Build (from server/):
+//   g++ -std=c++17 -O2 loadgen.cpp -o loadgen -pthread
+// On Windows (MinGW-w64) add -lws2_32 as for server.cpp.
+//
+// Each capture line is either a /search body ({"src": ..., "dest": ...}) or
+// an object carrying one under "body" (as an object or a JSON string).
+// Lines are replayed in order, wrapping around until --requests or
+// --duration is reached.
+//
+// With --rate R, requests are scheduled open-loop at R per second and each
+// latency is measured from its scheduled start, so a stalled server shows
+// up as latency instead of silently lowering the offered load. Without it,
+// each of the --concurrency workers sends its next request as soon as the
+// previous one returns.
+
+#define FLIGHTFARE_NO_MAIN
+#include "server.cpp"
+
+#include <fstream>
+#include <map>
+
+// ------------------------ Capture ------------------------
+
+vector<string> loadCapture(const string &path, long &skipped) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("cannot open " + path);
+    }
+
+    vector<string> bodies;
+    string line;
+    skipped = 0;
+    while (getline(in, line)) {
+        if (trimView(line).empty()) continue;
+        json entry = json::parse(line, nullptr, false);
+        if (entry.is_object() && entry.contains("body")) {
+            entry = entry["body"].is_string() ? json::parse(entry["body"].get<string>(), nullptr, false)
+                                              : entry["body"];
+        }
+        if (!entry.is_object() || !entry.contains("src") || !entry.contains("dest")) {
+            skipped++;
+            continue;
+        }
+        bodies.push_back(entry.dump());
+    }
+    return bodies;
+}
+
+// ------------------------ Replay ------------------------
+
+struct Options {
+    string capture = "searches.jsonl";
+    string host = "localhost";
+    int port = 8080;
+    bool inProcess = false;
+    bool keepAlive = true;
+    int concurrency = 8;
+    double rate = 0;         // requests/s, 0 for closed loop
+    long requests = 10000;
+    double duration = 0;     // seconds, 0 for no limit
+};
+
+struct WorkerResult {
+    vector<int64_t> latencies;  // nanoseconds
+    map<int, long> statuses;    // 0: transport error
+};
+
+// Send one body and return the HTTP status, 0 when no response came back
+using Sender = function<int(const string &body)>;
+
+Sender makeSender(const Options &options) {
+    if (options.inProcess) {
+        return [](const string &body) {
+            httplib::Request req;
+            httplib::Response res;
+            req.method = "POST";
+            req.path = "/search";
+            req.body = body;
+            handleSearch(req, res);
+            return res.status;
+        };
+    }
+
+    auto client = make_shared<httplib::Client>(options.host, options.port);
+    client->set_keep_alive(options.keepAlive);
+    client->set_tcp_nodelay(true);
+    client->set_read_timeout(60, 0);
+    return [client](const string &body) {
+        auto res = client->Post("/search", body, "application/json");
+        return res ? res->status : 0;
+    };
+}
+
+void replay(const Options &options, const vector<string> &bodies) {
+    using Clock = chrono::steady_clock;
+    atomic<long> nextRequest{0};
+    vector<WorkerResult> results(options.concurrency);
+    auto start = Clock::now() + chrono::milliseconds(10);
+    auto stopAt = options.duration > 0
+                      ? start + chrono::duration_cast<Clock::duration>(chrono::duration<double>(options.duration))
+                      : Clock::time_point::max();
+
+    auto worker = [&](int w) {
+        Sender send = makeSender(options);
+        WorkerResult &result = results[w];
+        for (;;) {
+            long i = nextRequest++;
+            if (i >= options.requests) break;
+
+            auto scheduled = options.rate > 0
+                                 ? start + chrono::duration_cast<Clock::duration>(
+                                               chrono::duration<double>(i / options.rate))
+                                 : Clock::now();
+            if (scheduled >= stopAt) break;
+            this_thread::sleep_until(scheduled);
+
+            int status = send(bodies[i % bodies.size()]);
+            auto done = Clock::now();
+            result.latencies.push_back(chrono::duration_cast<chrono::nanoseconds>(done - scheduled).count());
+            result.statuses[status]++;
+            if (done >= stopAt) break;
+        }
+    };
+
+    vector<thread> pool;
+    for (int w = 0; w < options.concurrency; w++) pool.emplace_back(worker, w);
+    for (auto &t : pool) t.join();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<int64_t> latencies;
+    map<int, long> statuses;
+    for (auto &result : results) {
+        latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+        for (auto [status, count] : result.statuses) statuses[status] += count;
+    }
+    sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) {
+        if (latencies.empty()) return 0.0;
+        size_t rank = min(latencies.size() - 1, (size_t)(p * latencies.size()));
+        return latencies[rank] / 1000.0;
+    };
+
+    cout << "\n" << latencies.size() << " requests in " << fixed << setprecision(2) << seconds << " s: "
+         << setprecision(0) << latencies.size() / seconds << " req/s";
+    if (options.rate > 0) cout << " (offered " << options.rate << " req/s)";
+    cout << endl;
+    for (auto [status, count] : statuses) {
+        cout << "  status " << (status == 0 ? string("error") : to_string(status)) << ": " << count << endl;
+    }
+    cout << "latency (us)  p50 " << setprecision(1) << percentile(0.50)
+         << "   p99 " << percentile(0.99)
+         << "   p999 " << percentile(0.999)
+         << "   max " << (latencies.empty() ? 0.0 : latencies.back() / 1000.0) << endl;
+}
+
+// ------------------------ Main ------------------------
+
+int main(int argc, char *argv[]) {
+    Options options;
+    int cacheEntries = DEFAULT_CACHE_ENTRIES;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--capture" && i + 1 < argc) {
+            options.capture = argv[++i];
+        } else if (arg == "--host" && i + 1 < argc) {
+            options.host = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            options.port = atoi(argv[++i]);
+        } else if (arg == "--in-process") {
+            options.inProcess = true;
+        } else if (arg == "--data" && i + 1 < argc) {
+            networkSource.dataFile = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            networkSource.snapshotFile = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheEntries = max(atoi(argv[++i]), 0);
+        } else if (arg == "--no-keep-alive") {
+            options.keepAlive = false;
+        } else if (arg == "--concurrency" && i + 1 < argc) {
+            options.concurrency = max(atoi(argv[++i]), 1);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            options.rate = max(atof(argv[++i]), 0.0);
+        } else if (arg == "--requests" && i + 1 < argc) {
+            options.requests = max(atol(argv[++i]), 1L);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            options.duration = max(atof(argv[++i]), 0.0);
+            options.requests = numeric_limits<long>::max();
+        } else {
+            cerr << "usage: loadgen [--capture FILE] [--host H] [--port P] [--in-process [--data FILE | --snapshot FILE] [--cache N]]\n"
+                    "               [--concurrency N] [--rate R] [--requests N | --duration S] [--no-keep-alive]"
+                 << endl;
+            return 2;
+        }
+    }
+
+    try {
+        long skipped = 0;
+        vector<string> bodies = loadCapture(options.capture, skipped);
+        if (bodies.empty()) {
+            throw runtime_error(options.capture + ": no /search bodies");
+        }
+        cout << "✓ " << bodies.size() << " search bodies from " << options.capture;
+        if (skipped > 0) cout << " (" << skipped << " other lines skipped)";
+        cout << endl;
+
+        if (options.inProcess) {
+            publishNetwork(loadNetwork(networkSource));
+            searchCache.setCapacity(cacheEntries);
+#ifdef _WIN32
+            FILE *discard = fopen("NUL", "w");
+#else
+            FILE *discard = fopen("/dev/null", "w");
+#endif
+            if (discard) requestLog.start(discard);
+        }
+
+        cout << (options.inProcess ? "in-process handleSearch" : options.host + ":" + to_string(options.port))
+             << ", " << options.concurrency << " workers, "
+             << (options.rate > 0 ? "open loop" : "closed loop")
+             << (options.inProcess ? "" : options.keepAlive ? ", keep-alive" : ", new connection per request")
+             << endl;
+        replay(options, bodies);
+    } catch (const exception &e) {
+        cerr << "✗ " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -10,19 +10,54 @@
 #include <algorithm>
 #include <limits>
 #include <set>
+#include <cstdint>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <list>
+#include <memory>
+#include <charconv>
+#include <string_view>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <fstream>
 
 #include "httplib.h"
 #include "json.hpp"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace std;
 using json = nlohmann::json;
 
 const int INF = 1e9;
 const int MAX_STOPS_LIMIT = 50;
+const int MAX_FARE = INF / (MAX_STOPS_LIMIT + 1);  // route sums stay below INF
 const int DEFAULT_MAX_STOPS = 5;
+const int DEFAULT_ROUTE_OPTIONS = 3;
+const int MAX_ROUTE_OPTIONS = 50;
+const int DEFAULT_CACHE_ENTRIES = 10000;
+const int MAX_AUTOCOMPLETE = 10;
+const int MAX_BATCH_QUERIES = 10000;
+const int DEFAULT_COMPUTE_QUEUE = 256;
+const int DEFAULT_SEARCH_DEADLINE_MS = 10000;
+const int DEFAULT_SEARCH_BUDGET_MS = 2000;
+const int DEFAULT_MAX_SPUR_SEARCHES = 20000;
 
 // ------------------------ Utility Functions ------------------------
 
@@ -39,47 +74,295 @@ string trim(const string &s) {
     return s.substr(a, b - a + 1);
 }
 
+string_view trimView(string_view s) {
+    size_t a = s.find_first_not_of(" \t\n\r");
+    if (a == string_view::npos) return {};
+    size_t b = s.find_last_not_of(" \t\n\r");
+    return s.substr(a, b - a + 1);
+}
+
+bool equalsIgnoreCase(string_view a, string_view b) {
+    return a.size() == b.size() &&
+           equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return tolower((unsigned char)x) == tolower((unsigned char)y);
+           });
+}
+
+// "YYYY-MM-DD HH:MM:SS" in local time, thread-safe
+void formatTimestamp(time_t time, char out[20]) {
+    tm parts;
+#ifdef _WIN32
+    localtime_s(&parts, &time);
+#else
+    localtime_r(&time, &parts);
+#endif
+    strftime(out, 20, "%Y-%m-%d %H:%M:%S", &parts);
+}
+
 string getCurrentTimestamp() {
-    auto now = chrono::system_clock::now();
-    auto time = chrono::system_clock::to_time_t(now);
-    stringstream ss;
-    ss << put_time(localtime(&time), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+    char text[20];
+    formatTimestamp(chrono::system_clock::to_time_t(chrono::system_clock::now()), text);
+    return text;
+}
+
+inline int64_t epochSeconds() {
+    return chrono::duration_cast<chrono::seconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Log writer that never blocks a handler on output. Handlers claim a slot
+// in a bounded multi-producer ring (one compare-and-swap, no lock) and copy
+// a fixed-size Record in; one background thread formats whatever is ready
+// and writes it with a single fwrite. The timestamp text is rebuilt only
+// when the second changes. If the ring is full the record is dropped and
+// counted. Record needs an int64_t `time` (epoch seconds) and
+// format(timestamp, out), which appends one line.
+template <typename Record>
+class AsyncLogger {
+public:
+    ~AsyncLogger() { stop(); }
+
+    void start(FILE *output = stdout) {
+        if (running.exchange(true)) return;
+        out = output;
+        writer = thread([this] { drain(); });
+    }
+
+    void stop() {
+        if (!running.exchange(false)) return;
+        writer.join();
+        flush();
+        if (out != stdout) fclose(out);
+        out = stdout;
+    }
+
+    bool started() const { return running.load(memory_order_relaxed); }
+
+    void log(const Record &record) {
+        if (!started()) {
+            // Not started (tools, startup): write through
+            char timestamp[20];
+            string line;
+            formatTimestamp((time_t)record.time, timestamp);
+            record.format(timestamp, line);
+            fwrite(line.data(), 1, line.size(), stdout);
+            return;
+        }
+
+        // Vyukov bounded queue: a slot is free for ticket t when its
+        // sequence equals t, and published when it equals t + 1
+        size_t ticket = tail.load(memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[ticket & (CAPACITY - 1)];
+            size_t seq = slot.seq.load(memory_order_acquire);
+            if (seq == ticket) {
+                if (tail.compare_exchange_weak(ticket, ticket + 1, memory_order_relaxed)) {
+                    slot.record = record;
+                    slot.seq.store(ticket + 1, memory_order_release);
+                    return;
+                }
+            } else if (seq < ticket) {
+                dropped.fetch_add(1, memory_order_relaxed);
+                return;
+            } else {
+                ticket = tail.load(memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static const size_t CAPACITY = 1 << 14;
+
+    struct Slot {
+        atomic<size_t> seq;
+        Record record;
+    };
+
+    // Format every published record and write them in one call
+    bool flush() {
+        batch.clear();
+        for (;;) {
+            Slot &slot = slots[head & (CAPACITY - 1)];
+            if (slot.seq.load(memory_order_acquire) != head + 1) break;
+            if (slot.record.time != cachedSecond) {
+                cachedSecond = slot.record.time;
+                formatTimestamp((time_t)cachedSecond, cachedText);
+            }
+            slot.record.format(cachedText, batch);
+            slot.seq.store(head + CAPACITY, memory_order_release);
+            head++;
+        }
+        uint64_t lost = dropped.exchange(0, memory_order_relaxed);
+        if (lost > 0) {
+            fprintf(stderr, "[log] %llu log records dropped\n", (unsigned long long)lost);
+        }
+        if (batch.empty()) return false;
+        fwrite(batch.data(), 1, batch.size(), out);
+        fflush(out);
+        return true;
+    }
+
+    // Poll with a backoff that grows while idle, so a quiet server wakes
+    // rarely and a busy one writes in large batches
+    void drain() {
+        int idleMs = 1;
+        while (running.load(memory_order_relaxed)) {
+            if (flush()) {
+                idleMs = 1;
+            } else {
+                idleMs = min(idleMs * 2, 50);
+            }
+            this_thread::sleep_for(chrono::milliseconds(idleMs));
+        }
+    }
+
+    static unique_ptr<Slot[]> makeSlots() {
+        unique_ptr<Slot[]> s(new Slot[CAPACITY]);
+        for (size_t i = 0; i < CAPACITY; i++) s[i].seq.store(i, memory_order_relaxed);
+        return s;
+    }
+
+    unique_ptr<Slot[]> slots = makeSlots();
+    alignas(64) atomic<size_t> tail{0};
+    alignas(64) size_t head = 0;  // writer thread only
+    atomic<uint64_t> dropped{0};
+    atomic<bool> running{false};
+    FILE *out = stdout;
+    thread writer;
+    string batch;
+    int64_t cachedSecond = -1;
+    char cachedText[20] = "";
+};
+
+inline void copyField(char *out, size_t size, string_view text) {
+    size_t n = min(text.size(), size - 1);
+    memcpy(out, text.data(), n);
+    out[n] = '\0';
 }
 
-void logRequest(const string& method, const string& path, int status) {
-    cout << "[" << getCurrentTimestamp() << "] " 
-         << method << " " << path << " - Status: " << status << endl;
+// One line of the request log
+struct RequestRecord {
+    int64_t time;
+    int32_t status;
+    char method[8];
+    char path[44];
+
+    void format(const char *timestamp, string &out) const {
+        char line[128];
+        int n = snprintf(line, sizeof(line), "[%s] %s %s - Status: %d\n",
+                         timestamp, method, path, (int)status);
+        out.append(line, min(n, (int)sizeof(line) - 1));
+    }
+};
+
+AsyncLogger<RequestRecord> requestLog;
+
+void logRequest(string_view method, string_view path, int status) {
+    RequestRecord record;
+    record.time = epochSeconds();
+    record.status = status;
+    copyField(record.method, sizeof(record.method), method);
+    copyField(record.path, sizeof(record.path), path);
+    requestLog.log(record);
 }
 
 // ------------------------ Levenshtein Distance ------------------------
 
-int levenshtein(const string &a, const string &b) {
-    int n = a.size(), m = b.size();
-    if (n == 0) return m;
-    if (m == 0) return n;
-    
-    vector<vector<int>> dp(n + 1, vector<int>(m + 1));
-    for (int i = 0; i <= n; i++) dp[i][0] = i;
-    for (int j = 0; j <= m; j++) dp[0][j] = j;
+// Edit distance from a fixed pattern to many texts. Patterns of up to 64
+// bytes use the bit-parallel algorithm of Myers (in Hyyrö's formulation),
+// one machine word per text character; longer ones fall back to a banded
+// two-row DP. With foldCase, text characters are lowercased on the fly and
+// the pattern should already be lowercase.
+class EditDistancePattern {
+public:
+    explicit EditDistancePattern(string p, bool foldCase = true)
+        : pattern(move(p)), foldCase(foldCase) {
+        if (pattern.size() <= 64) {
+            for (size_t i = 0; i < pattern.size(); i++) {
+                peq[(unsigned char)pattern[i]] |= uint64_t(1) << i;
+            }
+        }
+    }
+
+    // Distance to text, or maxDist + 1 as soon as it must exceed maxDist
+    int distance(string_view text, int maxDist) const {
+        int m = pattern.size(), n = text.size();
+        if (abs(m - n) > maxDist) return maxDist + 1;
+        if (m == 0) return n;
+        if (m > 64) return bandedDistance(text, maxDist);
+
+        uint64_t pv = ~uint64_t(0), mv = 0;
+        uint64_t high = uint64_t(1) << (m - 1);
+        int score = m;
+
+        for (int j = 0; j < n; j++) {
+            uint64_t eq = peq[fold(text[j])];
+            uint64_t xv = eq | mv;
+            uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            uint64_t ph = mv | ~(xh | pv);
+            uint64_t mh = pv & xh;
+
+            if (ph & high) score++;
+            else if (mh & high) score--;
+
+            // The score can drop by at most one per remaining character
+            if (score - (n - j - 1) > maxDist) return maxDist + 1;
 
-    for (int i = 1; i <= n; i++) {
-        for (int j = 1; j <= m; j++) {
-            dp[i][j] = (a[i - 1] == b[j - 1])
-                           ? dp[i - 1][j - 1]
-                           : 1 + min({ dp[i - 1][j], dp[i][j - 1], dp[i - 1][j - 1] });
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
         }
+        return score <= maxDist ? score : maxDist + 1;
     }
 
-    return dp[n][m];
+private:
+    unsigned char fold(char c) const {
+        return foldCase ? (unsigned char)tolower((unsigned char)c) : (unsigned char)c;
+    }
+
+    // Two-row DP restricted to the diagonal band |i - j| <= maxDist
+    int bandedDistance(string_view text, int maxDist) const {
+        int m = pattern.size(), n = text.size();
+        int over = maxDist + 1;
+        vector<int> prev(n + 1), cur(n + 1);
+        for (int j = 0; j <= n; j++) prev[j] = min(j, over);
+
+        for (int i = 1; i <= m; i++) {
+            int lo = max(1, i - maxDist), hi = min(n, i + maxDist);
+            cur[lo - 1] = lo == 1 ? min(i, over) : over;
+            int rowMin = cur[lo - 1];
+            for (int j = lo; j <= hi; j++) {
+                int sub = prev[j - 1] + ((unsigned char)pattern[i - 1] != fold(text[j - 1]));
+                int del = j < i + maxDist ? prev[j] + 1 : over;
+                int ins = cur[j - 1] + 1;
+                cur[j] = min({ sub, del, ins, over });
+                rowMin = min(rowMin, cur[j]);
+            }
+            if (hi < n) cur[hi + 1] = over;
+            if (rowMin > maxDist) return over;
+            swap(prev, cur);
+        }
+        return min(prev[n], over);
+    }
+
+    string pattern;
+    bool foldCase;
+    uint64_t peq[256] = {};
+};
+
+int levenshtein(const string &a, const string &b) {
+    int bound = max(a.size(), b.size());
+    return EditDistancePattern(a, false).distance(b, bound);
 }
 
+// Reference linear scan; the server answers from a network's SuggestionIndex,
+// which returns the same suggestions
 vector<string> suggestCities(const string &wrong, const vector<string> &cities) {
     vector<pair<int, string>> scores;
-    string wrongLower = toLowerCase(wrong);
+    EditDistancePattern pattern(toLowerCase(wrong));
     
     for (const auto &c : cities) {
-        int dist = levenshtein(wrongLower, toLowerCase(c));
+        int dist = pattern.distance(c, 3);
         // Only suggest if distance is reasonable
         if (dist <= 3) {
             scores.push_back({ dist, c });
@@ -95,27 +378,314 @@ vector<string> suggestCities(const string &wrong, const vector<string> &cities)
     return result;
 }
 
+// Fuzzy lookup over the lowercased city names and aliases ("terms"), built
+// once per network. Candidates come from one of two exact filters, then the
+// edit distance decides:
+//  - Trigram count filter: with the term padded by two marks on each side,
+//    every edit destroys at most three of its distinct trigrams, so a term
+//    within k edits shares at least (query trigrams - 3k) of them. Posting
+//    lists are scanned once per query trigram into a per-term counter.
+//  - When that bound is below one (short queries), a symmetric-deletion
+//    dictionary over the short terms: two strings within k edits always
+//    share a string reachable from both by at most k deletions.
+// Aliases are held to a tighter distance, since a short code is within a
+// few edits of almost any short input: codes of up to three letters match
+// only exactly, and longer aliases within a third of the shorter of alias
+// and query. Suggestions are distinct cities ordered by (distance, name),
+// with a city matched by its name ahead of one matched only by an alias at
+// the same distance, so they equal suggestCities() when there are no
+// aliases.
+class SuggestionIndex {
+public:
+    static constexpr int MAX_DELETES = 3;
+    static constexpr int MAX_SHORT_QUERY = 3 * MAX_DELETES - 2;  // longest query with no trigram bound
+    static constexpr int MAX_SHORT_TERM = MAX_SHORT_QUERY + MAX_DELETES;
+
+    void build(const vector<string> &cities, const vector<pair<string, int>> &aliases) {
+        terms.clear();
+        termCity.clear();
+        for (int c = 0; c < (int)cities.size(); c++) addTerm(cities[c], c);
+        nameTerms = (int)terms.size();
+        for (const auto &[alias, city] : aliases) addTerm(alias, city);
+
+        vector<pair<uint32_t, int>> gramEntries;
+        vector<pair<uint64_t, int>> deleteEntries;
+        vector<uint32_t> gramsOfTerm;
+        vector<uint64_t> variants;
+        string buffer;
+
+        for (int t = 0; t < (int)terms.size(); t++) {
+            trigrams(terms[t], gramsOfTerm);
+            for (uint32_t gram : gramsOfTerm) gramEntries.push_back({ gram, t });
+
+            if (terms[t].size() <= MAX_SHORT_TERM) {
+                variants.clear();
+                buffer = terms[t];
+                addDeletes(buffer, 0, MAX_DELETES, variants);
+                sort(variants.begin(), variants.end());
+                variants.erase(unique(variants.begin(), variants.end()), variants.end());
+                for (uint64_t h : variants) deleteEntries.push_back({ h, t });
+            }
+        }
+
+        sort(gramEntries.begin(), gramEntries.end());
+        grams.clear();
+        gramStart.clear();
+        postings.resize(gramEntries.size());
+        for (size_t i = 0; i < gramEntries.size(); i++) {
+            if (i == 0 || gramEntries[i].first != gramEntries[i - 1].first) {
+                grams.push_back(gramEntries[i].first);
+                gramStart.push_back(i);
+            }
+            postings[i] = gramEntries[i].second;
+        }
+        gramStart.push_back(gramEntries.size());
+
+        sort(deleteEntries.begin(), deleteEntries.end());
+        deleteKeys.resize(deleteEntries.size());
+        deleteTerms.resize(deleteEntries.size());
+        for (size_t i = 0; i < deleteEntries.size(); i++) {
+            deleteKeys[i] = deleteEntries[i].first;
+            deleteTerms[i] = deleteEntries[i].second;
+        }
+    }
+
+    vector<string> suggest(const string &wrong, const vector<string> &cities,
+                           int maxDist = 3, int limit = 3) const {
+        maxDist = min(maxDist, MAX_DELETES);
+        string lowered = toLowerCase(wrong);
+        EditDistancePattern pattern(lowered);
+        vector<int> candidates;
+
+        vector<uint32_t> queryGrams;
+        trigrams(lowered, queryGrams);
+        int needed = (int)queryGrams.size() - 3 * maxDist;
+
+        if (needed >= 1) {
+            countTrigrams(queryGrams, needed, candidates);
+        } else if ((int)lowered.size() <= MAX_SHORT_QUERY) {
+            vector<uint64_t> variants;
+            addDeletes(lowered, 0, maxDist, variants);
+            for (uint64_t h : variants) {
+                auto range = equal_range(deleteKeys.begin(), deleteKeys.end(), h);
+                for (auto it = range.first; it != range.second; ++it) {
+                    candidates.push_back(deleteTerms[it - deleteKeys.begin()]);
+                }
+            }
+        } else {
+            // Long but highly repetitive query: no filter applies
+            for (int t = 0; t < (int)terms.size(); t++) candidates.push_back(t);
+        }
+
+        // Best (distance, alias only) per city over its matching terms
+        vector<tuple<int, int, bool>> hits;  // (city, distance, alias)
+        for (int t : candidates) {
+            bool alias = t >= nameTerms;
+            int allowed = alias ? aliasDistance(terms[t], lowered, maxDist) : maxDist;
+            if (allowed < 0) continue;
+            int dist = pattern.distance(terms[t], allowed);
+            if (dist <= allowed) hits.push_back({ termCity[t], dist, alias });
+        }
+        sort(hits.begin(), hits.end());
+        hits.erase(unique(hits.begin(), hits.end(),
+                          [](const auto &a, const auto &b) { return get<0>(a) == get<0>(b); }),
+                   hits.end());
+
+        vector<tuple<int, bool, string>> scores;
+        for (const auto &[city, dist, alias] : hits) scores.push_back({ dist, alias, cities[city] });
+        sort(scores.begin(), scores.end());
+
+        vector<string> result;
+        for (int i = 0; i < min(limit, (int)scores.size()); i++) {
+            result.push_back(get<2>(scores[i]));
+        }
+        return result;
+    }
+
+    size_t memoryBytes() const {
+        size_t bytes = grams.capacity() * sizeof(uint32_t) + gramStart.capacity() * sizeof(int) +
+                       postings.capacity() * sizeof(int) + deleteKeys.capacity() * sizeof(uint64_t) +
+                       deleteTerms.capacity() * sizeof(int) + termCity.capacity() * sizeof(int);
+        for (const auto &t : terms) bytes += sizeof(string) + t.capacity();
+        return bytes;
+    }
+
+private:
+    // Edits allowed between the query and an alias; -1 when a short code
+    // cannot match without being equal
+    static int aliasDistance(const string &alias, const string &query, int maxDist) {
+        if (alias.size() <= 3) return alias == query ? 0 : -1;
+        return min(maxDist, (int)min(alias.size(), query.size()) / 3);
+    }
+
+    void addTerm(const string &term, int city) {
+        terms.push_back(toLowerCase(term));
+        termCity.push_back(city);
+    }
+
+    // Distinct trigrams of s padded with two 0x01 bytes on each side
+    static void trigrams(const string &s, vector<uint32_t> &out) {
+        out.clear();
+        string padded = "\x01\x01" + s + "\x01\x01";
+        for (size_t i = 0; i + 3 <= padded.size(); i++) {
+            out.push_back((uint32_t)(unsigned char)padded[i] << 16 |
+                          (uint32_t)(unsigned char)padded[i + 1] << 8 |
+                          (uint32_t)(unsigned char)padded[i + 2]);
+        }
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+    }
+
+    // Terms sharing at least `needed` of the query's trigrams
+    void countTrigrams(const vector<uint32_t> &queryGrams, int needed, vector<int> &out) const {
+        thread_local vector<uint16_t> counts;
+        thread_local vector<int> touched;
+        if (counts.size() < terms.size()) counts.resize(terms.size(), 0);
+
+        for (uint32_t gram : queryGrams) {
+            auto it = lower_bound(grams.begin(), grams.end(), gram);
+            if (it == grams.end() || *it != gram) continue;
+            size_t g = it - grams.begin();
+            for (int i = gramStart[g]; i < gramStart[g + 1]; i++) {
+                if (counts[postings[i]]++ == 0) touched.push_back(postings[i]);
+            }
+        }
+        for (int t : touched) {
+            if (counts[t] >= needed) out.push_back(t);
+            counts[t] = 0;
+        }
+        touched.clear();
+    }
+
+    static uint64_t hashName(const string &s) {
+        uint64_t h = 14695981039346656037ull;  // FNV-1a
+        for (unsigned char c : s) {
+            h = (h ^ c) * 1099511628211ull;
+        }
+        return h;
+    }
+
+    // Hashes of s and every string made by deleting up to `budget` characters
+    // at positions >= from (each position set once; repeats from equal
+    // letters are harmless)
+    static void addDeletes(string &s, size_t from, int budget, vector<uint64_t> &out) {
+        if (from == 0) out.push_back(hashName(s));
+        if (budget == 0) return;
+        for (size_t i = from; i < s.size(); i++) {
+            char removed = s[i];
+            s.erase(i, 1);
+            out.push_back(hashName(s));
+            addDeletes(s, i, budget - 1, out);
+            s.insert(s.begin() + i, removed);
+        }
+    }
+
+    vector<string> terms;     // lowercased names, then aliases
+    vector<int> termCity;
+    int nameTerms = 0;        // terms[0, nameTerms) are city names
+    vector<uint32_t> grams;   // sorted distinct trigrams
+    vector<int> gramStart;    // postings of grams[g] at [gramStart[g], gramStart[g + 1])
+    vector<int> postings;     // term ids, ascending per trigram
+    vector<uint64_t> deleteKeys;  // sorted deletion-variant hashes of short terms
+    vector<int> deleteTerms;
+};
+
 // ------------------------ Graph Logic ------------------------
 
+// One improvement found by a stop-limited sweep: the city, its new fare, the
+// round (legs - 1) that produced it and the record of the city it was reached
+// from. Following prev links yields a path with exactly round + 1 legs.
+struct HopRecord {
+    int city;
+    int prev;
+    int fare;
+    int round;
+};
+
+// Work done by sweeps on one thread, accumulated until the caller resets it
+struct SweepStats {
+    long long verticesExpanded = 0;  // frontier cities whose legs were scanned
+    long long edgesRelaxed = 0;
+    int frontierPeak = 0;
+};
+
+// Per-thread buffers reused by Graph::sweep across searches. Between
+// searches every slot holds INF / -1, so a search only pays for the cities
+// it actually reaches; reset() reallocates only when the graph has resized.
+struct ShortestScratch {
+    vector<int> dist, nextDist;
+    vector<int> record, nextPrev;
+    vector<uint64_t> nextBest;
+    vector<char> queued;
+    vector<int> frontier, changed, touched;
+    vector<HopRecord> records;
+    SweepStats stats;
+
+    void reset(int V) {
+        if ((int)dist.size() == V) return;
+        dist.assign(V, INF);
+        nextDist.assign(V, INF);
+        record.assign(V, -1);
+        nextPrev.assign(V, -1);
+        nextBest.resize(V);
+        queued.assign(V, 0);
+    }
+
+    void clearTouched() {
+        for (int v : touched) {
+            dist[v] = nextDist[v] = INF;
+            record[v] = nextPrev[v] = -1;
+        }
+        touched.clear();
+        records.clear();
+    }
+};
+
+inline ShortestScratch &shortestScratch() {
+    thread_local ShortestScratch scratch;
+    return scratch;
+}
+
 struct Route {
     int cost;
     vector<int> path;
     int stops;
 };
 
+// Limits on one findMultipleRoutes call; each spur search is one sweep.
+// When either runs out, the routes confirmed so far are returned.
+struct SearchBudget {
+    long long maxSpurSearches = 0;  // 0: unlimited
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+};
+
 class Graph {
 public:
     int V;
-    vector<vector<pair<int, int>>> adj;
+
+    // Frozen compressed sparse row (CSR) edge store. The out-edges of u live
+    // at [offsets[u], offsets[u + 1]) in edgeTo/edgeCost, so route searches
+    // walk contiguous memory instead of one heap block per city. The arrays
+    // are either owned by this Graph or point into a mapped snapshot.
+    const int *offsets = nullptr;
+    const int *edgeTo = nullptr;
+    const int *edgeCost = nullptr;
 
     Graph(int v = 0) { 
         V = v; 
-        adj.assign(V, {}); 
+        offsetStore.assign(V + 1, 0);
+        bindStores();
     }
 
+    // The edge pointers refer to owned storage, so graphs move but never copy
+    Graph(const Graph &) = delete;
+    Graph &operator=(const Graph &) = delete;
+    Graph(Graph &&) = default;
+    Graph &operator=(Graph &&) = default;
+
     void addEdge(int u, int v, int cost) {
         if (cost >= 0 && u >= 0 && u < V && v >= 0 && v < V) {
-            adj[u].push_back({ v, cost });
+            pending.push_back({ u, v, cost });
         }
     }
 
@@ -124,175 +694,1779 @@ public:
         addEdge(v, u, cost);
     }
 
-    // Find cheapest path with maximum stops constraint
-    pair<int, vector<int>> shortest(int src, int dest, int maxStops) {
-        if (src == dest) {
-            return { 0, {src} };
+    // Build the CSR arrays from the edges added so far. Edges keep their
+    // insertion order within each city, so search tie-breaking is unchanged.
+    void freeze() {
+        offsetStore.assign(V + 1, 0);
+        for (const auto &e : pending) offsetStore[e.from + 1]++;
+        for (int u = 0; u < V; u++) offsetStore[u + 1] += offsetStore[u];
+
+        toStore.assign(pending.size(), 0);
+        costStore.assign(pending.size(), 0);
+        vector<int> next(offsetStore.begin(), offsetStore.end() - 1);
+        for (const auto &e : pending) {
+            int slot = next[e.from]++;
+            toStore[slot] = e.to;
+            costStore[slot] = e.cost;
         }
 
-        vector<int> dist(V, INF), parent(V, -1);
-        dist[src] = 0;
+        pending.clear();
+        pending.shrink_to_fit();
+        bindStores();
+    }
 
-        // Bellman-Ford with stop limit
-        for (int k = 0; k <= maxStops; k++) {
-            bool updated = false;
-            vector<int> newDist = dist;
-            vector<int> newParent = parent;
+    // Use CSR arrays that live elsewhere (e.g. a mapped snapshot) in place.
+    // `owner` keeps that memory alive for as long as this graph exists.
+    void attach(int v, int e, const int *off, const int *to, const int *cost,
+                shared_ptr<const void> owner) {
+        V = v;
+        E = e;
+        offsets = off;
+        edgeTo = to;
+        edgeCost = cost;
+        backing = move(owner);
+        offsetStore.clear();
+        toStore.clear();
+        costStore.clear();
+        pending.clear();
+    }
 
-            for (int u = 0; u < V; u++) {
-                if (dist[u] >= INF) continue;
-                
-                for (auto &edge : adj[u]) {
-                    int v = edge.first;
-                    int weight = edge.second;
-                    
-                    if (dist[u] + weight < newDist[v]) {
-                        newDist[v] = dist[u] + weight;
-                        newParent[v] = u;
-                        updated = true;
+    int edgeCount() const { return E; }
+
+    // Stop-limited Bellman-Ford from src into the calling thread's scratch.
+    // Afterwards scratch.dist/record hold the final fare and record of every
+    // reached city and scratch.records every improvement in round order.
+    // Cities flagged in blockedCity and edges flagged in blockedEdge (both
+    // optional) are skipped. Callers must finish with scratch.clearTouched().
+    ShortestScratch &sweep(int src, int maxStops,
+                           const char *blockedCity = nullptr,
+                           const char *blockedEdge = nullptr) const {
+        ShortestScratch &scratch = shortestScratch();
+        scratch.reset(V);
+        int *dist = scratch.dist.data(), *nextDist = scratch.nextDist.data();
+        int *record = scratch.record.data(), *nextPrev = scratch.nextPrev.data();
+        char *queued = scratch.queued.data();
+        vector<int> &frontier = scratch.frontier, &changed = scratch.changed;
+        vector<int> &touched = scratch.touched;
+        vector<HopRecord> &records = scratch.records;
+
+        dist[src] = nextDist[src] = 0;
+        record[src] = 0;
+        records.push_back({ src, -1, 0, -1 });
+        touched.push_back(src);
+        frontier.assign(1, src);
+
+        // Only cities whose fare improved in the previous round can improve
+        // a neighbour, so each round relaxes just that frontier (in ascending
+        // id order, which keeps tie-breaking identical to a full scan). dist
+        // holds the previous round and nextDist the current one; they are
+        // equal again on every city after each round.
+        //
+        // A sparse round collects the cities it improves as it relaxes. Once
+        // the frontier covers a good part of the graph that bookkeeping costs
+        // more than it saves, so a dense round only relaxes and then finds
+        // the improved cities by comparing dist and nextDist over all of them.
+        bool blockable = blockedCity || blockedEdge;
+        SweepStats &stats = scratch.stats;
+        for (int k = 0; k <= maxStops && !frontier.empty(); k++) {
+            changed.clear();
+            stats.frontierPeak = max(stats.frontierPeak, (int)frontier.size());
+            stats.verticesExpanded += frontier.size();
+
+            long long frontierEdges = 0;
+            for (int u : frontier) frontierEdges += offsets[u + 1] - offsets[u];
+
+            if ((long long)frontier.size() * 16 < V && frontierEdges * 16 < E) {
+                if (blockable) {
+                    relaxSparse<true>(scratch, blockedCity, blockedEdge);
+                } else {
+                    relaxSparse<false>(scratch, nullptr, nullptr);
+                }
+                // Sorting a change set that covers a good part of the graph
+                // costs more than collecting it from the queued flags
+                if ((long long)changed.size() * 16 < V) {
+                    sort(changed.begin(), changed.end());
+                } else {
+                    size_t changedCount = 0;
+                    changed.resize(V);
+                    for (int v = 0; v < V; v++) {
+                        changed[changedCount] = v;
+                        changedCount += queued[v];
                     }
+                    changed.resize(changedCount);
+                }
+                for (int v : changed) queued[v] = 0;
+            } else {
+                if (blockable) {
+                    relaxDense<true>(scratch, blockedCity, blockedEdge);
+                } else {
+                    relaxDense<false>(scratch, nullptr, nullptr);
                 }
+                // Unpack into nextDist/nextPrev. About half the cities change
+                // in such a round, so the scan writes every id and only
+                // advances past the changed ones rather than branching on them
+                const uint64_t *best = scratch.nextBest.data();
+                size_t changedCount = 0, touchedCount = touched.size();
+                changed.resize(V);
+                touched.resize(touchedCount + V);
+                for (int v = 0; v < V; v++) {
+                    int fare = (int)(best[v] >> 32);
+                    bool improved = fare < dist[v];
+                    nextDist[v] = fare;
+                    nextPrev[v] = improved ? (int)(uint32_t)best[v] : nextPrev[v];
+                    changed[changedCount] = v;
+                    changedCount += improved;
+                    touched[touchedCount] = v;
+                    touchedCount += improved && dist[v] >= INF;
+                }
+                changed.resize(changedCount);
+                touched.resize(touchedCount);
             }
-            
-            dist = newDist;
-            parent = newParent;
-            
-            if (!updated) break;
+
+            for (int v : changed) {
+                dist[v] = nextDist[v];
+                record[v] = (int)records.size();
+                records.push_back({ v, nextPrev[v], dist[v], k });
+            }
+            frontier.swap(changed);
         }
 
-        if (dist[dest] >= INF) {
-            return { -1, {} };
+        return scratch;
+    }
+
+    // Find cheapest path with maximum stops constraint
+    pair<int, vector<int>> shortest(int src, int dest, int maxStops,
+                                    const char *blockedCity = nullptr,
+                                    const char *blockedEdge = nullptr) const {
+        if (src == dest) {
+            return { 0, {src} };
         }
 
-        // Reconstruct path
+        ShortestScratch &scratch = sweep(src, maxStops, blockedCity, blockedEdge);
+        const vector<HopRecord> &records = scratch.records;
+        int fare = scratch.dist[dest];
         vector<int> path;
-        for (int v = dest; v != -1; v = parent[v]) {
-            path.push_back(v);
+        if (fare < INF) {
+            // Reconstruct path, sized up front so it is the only allocation
+            int hops = 0;
+            for (int r = scratch.record[dest]; r != -1; r = records[r].prev) hops++;
+            path.resize(hops);
+            for (int r = scratch.record[dest]; r != -1; r = records[r].prev) {
+                path[--hops] = records[r].city;
+            }
         }
-        reverse(path.begin(), path.end());
-        
-        return { dist[dest], path };
+        scratch.clearTouched();
+
+        if (fare >= INF) {
+            return { -1, {} };
+        }
+        return { fare, move(path) };
+    }
+
+    // Cheapest fare from src to every city reachable within maxStops, from
+    // one sweep: (city, fare, legs, previous city) for each, cheapest first.
+    vector<tuple<int, int, int, int>> faresFrom(int src, int maxStops) const {
+        ShortestScratch &scratch = sweep(src, maxStops);
+        const vector<HopRecord> &records = scratch.records;
+        vector<tuple<int, int, int, int>> fares;
+        fares.reserve(scratch.touched.size());
+        for (int v : scratch.touched) {
+            if (v == src) continue;
+            const HopRecord &h = records[scratch.record[v]];
+            fares.emplace_back(v, h.fare, h.round + 1, records[h.prev].city);
+        }
+        scratch.clearTouched();
+        sort(fares.begin(), fares.end(), [](const auto &a, const auto &b) {
+            return get<1>(a) != get<1>(b) ? get<1>(a) < get<1>(b) : get<0>(a) < get<0>(b);
+        });
+        return fares;
+    }
+
+    // shortest(src, dest, stops) for every (dest, stops) target from a single
+    // sweep with the largest stops. Rounds up to s replay exactly as in a
+    // sweep limited to s, so a target's answer is its city's last record
+    // from round s or earlier.
+    vector<pair<int, vector<int>>> shortestToMany(int src, const vector<pair<int, int>> &targets) const {
+        vector<pair<int, vector<int>>> results(targets.size(), { -1, {} });
+        int maxStops = -1;
+        for (const auto &[dest, stops] : targets) maxStops = max(maxStops, stops);
+        if (maxStops < 0) return results;
+
+        ShortestScratch &scratch = sweep(src, maxStops);
+        const vector<HopRecord> &records = scratch.records;
+
+        // Earlier record of the same city, for targets with fewer stops
+        thread_local vector<int> lastRecord;
+        vector<int> sameCityBefore;
+        bool mixedStops = false;
+        for (const auto &target : targets) mixedStops |= target.second < maxStops;
+        if (mixedStops) {
+            if ((int)lastRecord.size() < V) lastRecord.resize(V, -1);
+            sameCityBefore.resize(records.size());
+            for (size_t r = 0; r < records.size(); r++) {
+                sameCityBefore[r] = lastRecord[records[r].city];
+                lastRecord[records[r].city] = (int)r;
+            }
+            for (const HopRecord &h : records) lastRecord[h.city] = -1;
+        }
+
+        for (size_t i = 0; i < targets.size(); i++) {
+            auto [dest, stops] = targets[i];
+            if (dest == src) {
+                results[i] = { 0, {src} };
+                continue;
+            }
+            int r = scratch.record[dest];
+            while (r > 0 && records[r].round > stops) r = sameCityBefore[r];
+            if (r <= 0) continue;
+
+            int hops = 0;
+            for (int j = r; j != -1; j = records[j].prev) hops++;
+            vector<int> path(hops);
+            for (int j = r; j != -1; j = records[j].prev) path[--hops] = records[j].city;
+            results[i] = { records[r].fare, move(path) };
+        }
+        scratch.clearTouched();
+        return results;
     }
 
-    // Find multiple route options (using modified Dijkstra)
-    vector<Route> findMultipleRoutes(int src, int dest, int maxStops, int maxResults = 3) {
+    // Find up to maxResults cheapest loopless routes of at most maxStops legs
+    // (Yen's k-shortest paths). Each spur search reuses shortest() with the
+    // root path's cities and the already-taken next legs blocked. If the
+    // budget runs out first, *truncated is set and the cheapest routes
+    // confirmed so far are returned.
+    vector<Route> findMultipleRoutes(int src, int dest, int maxStops, int maxResults = 3,
+                                     const SearchBudget &budget = {}, bool *truncated = nullptr) const {
+        if (truncated) *truncated = false;
         if (src == dest) {
             return { {0, {src}, 0} };
         }
 
-        // Priority queue: (cost, node, path, stops)
-        priority_queue<tuple<int, int, vector<int>, int>,
-                      vector<tuple<int, int, vector<int>, int>>,
-                      greater<tuple<int, int, vector<int>, int>>> pq;
-        
-        pq.push({0, src, {src}, 0});
-        
         vector<Route> results;
-        set<int> visitedCosts; // Track different cost routes found
+        if (maxStops < 1 || maxResults < 1) return results;
+
+        auto first = shortest(src, dest, maxStops - 1);
+        if (first.first == -1) return results;
+        results.push_back({first.first, first.second, (int)first.second.size() - 1});
+
+        // Candidates ordered by (cost, path); the set also drops duplicates.
+        // Only the cheapest (maxResults - found) can ever be picked, since
+        // new candidates only push the rest further back, so the set is
+        // trimmed to that.
+        set<pair<int, vector<int>>> candidates;
+        vector<char> blockedCity(V, 0), blockedEdge(E, 0);
+        long long spurSearches = 0;
+        bool outOfBudget = false;
         
-        while (!pq.empty() && results.size() < maxResults) {
-            auto [cost, node, path, stops] = pq.top();
-            pq.pop();
-            
-            if (node == dest) {
-                // Avoid duplicate costs
-                if (visitedCosts.find(cost) == visitedCosts.end()) {
-                    results.push_back({cost, path, stops});
-                    visitedCosts.insert(cost);
+        while ((int)results.size() < maxResults && !outOfBudget) {
+            const vector<int> prev = results.back().path;
+            int rootCost = 0;
+
+            for (int j = 0; j + 1 < (int)prev.size(); j++) {
+                if ((budget.maxSpurSearches > 0 && spurSearches >= budget.maxSpurSearches) ||
+                    chrono::steady_clock::now() >= budget.deadline) {
+                    outOfBudget = true;
+                    break;
                 }
-                continue;
+                spurSearches++;
+                int spur = prev[j];
+
+                for (const auto &r : results) {
+                    if (sharesRoot(r.path, prev, j)) setLegBlocked(blockedEdge, r.path[j], r.path[j + 1], 1);
+                }
+                for (int i = 0; i < j; i++) blockedCity[prev[i]] = 1;
+
+                auto spurRoute = shortest(spur, dest, maxStops - j - 1,
+                                          blockedCity.data(), blockedEdge.data());
+                if (spurRoute.first != -1) {
+                    vector<int> path(prev.begin(), prev.begin() + j);
+                    path.insert(path.end(), spurRoute.second.begin(), spurRoute.second.end());
+                    candidates.insert({rootCost + spurRoute.first, move(path)});
+                    if (candidates.size() > (size_t)(maxResults - results.size())) {
+                        candidates.erase(std::prev(candidates.end()));
+                    }
+                }
+
+                for (const auto &r : results) {
+                    if (sharesRoot(r.path, prev, j)) setLegBlocked(blockedEdge, r.path[j], r.path[j + 1], 0);
+                }
+                for (int i = 0; i < j; i++) blockedCity[prev[i]] = 0;
+
+                rootCost += legCost(prev[j], prev[j + 1]);
             }
             
-            if (stops >= maxStops) continue;
-            
-            for (auto &edge : adj[node]) {
-                int nextNode = edge.first;
-                int edgeCost = edge.second;
-                
-                // Avoid cycles
-                if (find(path.begin(), path.end(), nextNode) != path.end()) {
-                    continue;
-                }
-                
-                vector<int> newPath = path;
-                newPath.push_back(nextNode);
-                
-                pq.push({cost + edgeCost, nextNode, newPath, stops + 1});
+            if (outOfBudget) {
+                if (truncated) *truncated = true;
+                break;
             }
+            if (candidates.empty()) break;
+            auto best = candidates.begin();
+            int stops = (int)best->second.size() - 1;
+            results.push_back({best->first, best->second, stops});
+            candidates.erase(best);
         }
         
         return results;
     }
+
+private:
+    // The relaxation loops of one sweep round, compiled per case so that
+    // searches without blocked arrays pay for no checks. Loop bounds are read
+    // once per city since a store to nextDist could otherwise alias offsets.
+    //
+    // A sparse round relaxes scratch.frontier into nextDist/nextPrev and
+    // records each city it improves in scratch.changed (unsorted) and
+    // scratch.touched.
+    template <bool Blockable>
+    void relaxSparse(ShortestScratch &scratch, const char *blockedCity, const char *blockedEdge) const {
+        const int *dist = scratch.dist.data(), *record = scratch.record.data();
+        int *nextDist = scratch.nextDist.data(), *nextPrev = scratch.nextPrev.data();
+        char *queued = scratch.queued.data();
+        const int *to = edgeTo, *cost = edgeCost;
+        long long edges = 0;
+
+        for (int u : scratch.frontier) {
+            int du = dist[u], ru = record[u];
+            int begin = offsets[u], end = offsets[u + 1];
+            edges += end - begin;
+
+            for (int e = begin; e < end; e++) {
+                int v = to[e];
+                if (Blockable) {
+                    if (blockedEdge && blockedEdge[e]) continue;
+                    if (blockedCity && blockedCity[v]) continue;
+                }
+
+                int fare = du + cost[e];
+                if (fare < nextDist[v]) {
+                    if (nextDist[v] >= INF) scratch.touched.push_back(v);
+                    if (!queued[v]) {
+                        queued[v] = 1;
+                        scratch.changed.push_back(v);
+                    }
+                    nextDist[v] = fare;
+                    nextPrev[v] = ru;
+                }
+            }
+        }
+        scratch.stats.edgesRelaxed += edges;
+    }
+
+    // A dense round relaxes into scratch.nextBest, one word per city with the
+    // fare in the high half and the record it was reached from in the low
+    // half, so that an improvement is a branchless min. Frontier records
+    // ascend with city id, so on equal fares the smaller record wins just as
+    // the first city in id order does with a strict compare; a city's own
+    // fare starts with record 0 and is therefore only replaced by a cheaper
+    // one.
+    template <bool Blockable>
+    void relaxDense(ShortestScratch &scratch, const char *blockedCity, const char *blockedEdge) const {
+        const int *dist = scratch.dist.data(), *record = scratch.record.data();
+        uint64_t *best = scratch.nextBest.data();
+        const int *to = edgeTo, *cost = edgeCost;
+        long long edges = 0;
+
+        for (int v = 0; v < V; v++) best[v] = (uint64_t)dist[v] << 32;
+        for (int u : scratch.frontier) {
+            uint64_t from = (uint64_t)dist[u] << 32 | (uint32_t)record[u];
+            int begin = offsets[u], end = offsets[u + 1];
+            edges += end - begin;
+
+            for (int e = begin; e < end; e++) {
+                int v = to[e];
+                if (Blockable) {
+                    if (blockedEdge && blockedEdge[e]) continue;
+                    if (blockedCity && blockedCity[v]) continue;
+                }
+
+                uint64_t candidate = from + ((uint64_t)cost[e] << 32);
+                best[v] = candidate < best[v] ? candidate : best[v];
+            }
+        }
+        scratch.stats.edgesRelaxed += edges;
+    }
+
+    // Cheapest direct leg from u to v (the one route searches always take)
+    int legCost(int u, int v) const {
+        int best = INF;
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            if (edgeTo[e] == v) best = min(best, edgeCost[e]);
+        }
+        return best;
+    }
+
+    void setLegBlocked(vector<char> &blockedEdge, int u, int v, char blocked) const {
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            if (edgeTo[e] == v) blockedEdge[e] = blocked;
+        }
+    }
+
+    // True when path starts with the first j + 1 cities of root and continues
+    static bool sharesRoot(const vector<int> &path, const vector<int> &root, int j) {
+        return (int)path.size() > j + 1 && equal(root.begin(), root.begin() + j + 1, path.begin());
+    }
+
+    void bindStores() {
+        E = (int)toStore.size();
+        offsets = offsetStore.data();
+        edgeTo = toStore.data();
+        edgeCost = costStore.data();
+        backing.reset();
+    }
+
+    struct PendingEdge {
+        int from, to, cost;
+    };
+    vector<PendingEdge> pending;
+
+    int E = 0;
+    vector<int> offsetStore, toStore, costStore;
+    shared_ptr<const void> backing;
 };
 
-// ------------------------ Data Management ------------------------
+// ------------------------ Work Pool ------------------------
 
-vector<string> idToCity;
-unordered_map<string, int> cityMap;
-Graph g;
+inline int workerCount() {
+    return max(1u, thread::hardware_concurrency());
+}
 
-void initData() {
-    idToCity = {
-        "Delhi", "Mumbai", "Goa", "Chennai", "Jaipur",
-        "Bangalore", "Kolkata", "Hyderabad", "Pune", "Ahmedabad",
-        "Kochi", "Varanasi", "Amritsar", "Lucknow", "Chandigarh", "Patna"
+// Helper threads for parallelFor, started on first use and kept for the
+// life of the process, so their thread_local sweep scratch is reused from
+// call to call. Concurrent calls share the same workerCount() - 1 helpers,
+// and every call's own thread works on it too, so a call finishes even when
+// all helpers are busy elsewhere.
+class WorkPool {
+public:
+    // One parallelFor call; run(w) is worker w's share
+    struct Job {
+        function<void(int worker)> run;
+        int workers = 1;
+        int joined = 1;  // worker ids handed out; the caller is 0
+        int active = 0;  // helpers still inside run()
     };
 
-    cityMap.clear();
-    for (size_t i = 0; i < idToCity.size(); i++) {
-        cityMap[toLowerCase(idToCity[i])] = i;
+    ~WorkPool() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : threads) t.join();
     }
 
-    g = Graph(idToCity.size());
+    // Run job.run(0) here and job.run(1..) on helpers as they come free;
+    // returns when every share that started has finished
+    void run(Job &job) {
+        call_once(started, [this] {
+            for (int i = 1; i < workerCount(); i++) threads.emplace_back([this] { work(); });
+        });
+        {
+            lock_guard<mutex> lock(mtx);
+            open.push_back(&job);
+        }
+        for (int i = 1; i < job.workers; i++) wake.notify_one();
 
-    // Define bidirectional routes (more realistic)
-    g.addBidirectionalEdge(cityMap["delhi"], cityMap["mumbai"], 5000);
-    g.addBidirectionalEdge(cityMap["delhi"], cityMap["goa"], 7000);
-    g.addBidirectionalEdge(cityMap["delhi"], cityMap["bangalore"], 6500);
-    g.addBidirectionalEdge(cityMap["delhi"], cityMap["kolkata"], 5500);
-    g.addBidirectionalEdge(cityMap["delhi"], cityMap["jaipur"], 3000);
+        job.run(0);
+
+        unique_lock<mutex> lock(mtx);
+        auto it = find(open.begin(), open.end(), &job);
+        if (it != open.end()) open.erase(it);
+        done.wait(lock, [&] { return job.active == 0; });
+    }
+
+    size_t threadCount() {
+        lock_guard<mutex> lock(mtx);
+        return threads.size();
+    }
+
+private:
+    void work() {
+        unique_lock<mutex> lock(mtx);
+        for (;;) {
+            wake.wait(lock, [this] { return stopping || !open.empty(); });
+            if (stopping) return;
+
+            Job *job = open.front();
+            int worker = job->joined++;
+            if (job->joined == job->workers) open.pop_front();
+            job->active++;
+            lock.unlock();
+
+            job->run(worker);
+
+            lock.lock();
+            if (--job->active == 0) done.notify_all();
+        }
+    }
+
+    vector<thread> threads;
+    once_flag started;
+    mutex mtx;
+    condition_variable wake, done;
+    deque<Job *> open;  // jobs with worker ids left to hand out
+    bool stopping = false;
+};
+
+WorkPool workPool;
+
+// Run fn(item, worker) for every item in [0, count) on up to `workers`
+// threads, the caller being worker 0 and the rest workPool helpers. Each
+// worker starts on its own contiguous block and takes items from its front;
+// a worker that runs dry steals the back half of the largest remaining block
+// (including blocks no helper was free to pick up), so uneven items (a hub's
+// sweep costs far more than a leaf's) still keep every core busy. Per-item
+// state belongs in thread_local or per-worker storage.
+template <typename Fn>
+void parallelFor(int count, int workers, const Fn &fn) {
+    workers = max(1, min(workers, count));
+    struct alignas(64) Block {
+        mutex lock;
+        int next = 0, end = 0;
+    };
+    unique_ptr<Block[]> blocks(new Block[workers]);
+    for (int w = 0; w < workers; w++) {
+        blocks[w].next = (int)((long long)count * w / workers);
+        blocks[w].end = (int)((long long)count * (w + 1) / workers);
+    }
+
+    auto steal = [&](int w) {
+        for (;;) {
+            int victim = -1, largest = 0;
+            for (int v = 0; v < workers; v++) {
+                lock_guard<mutex> guard(blocks[v].lock);
+                if (blocks[v].end - blocks[v].next > largest) {
+                    largest = blocks[v].end - blocks[v].next;
+                    victim = v;
+                }
+            }
+            if (victim < 0) return false;
+
+            int from, to;
+            {
+                lock_guard<mutex> guard(blocks[victim].lock);
+                int left = blocks[victim].end - blocks[victim].next;
+                if (left <= 0) continue;  // emptied meanwhile; look again
+                to = blocks[victim].end;
+                from = to - (left + 1) / 2;
+                blocks[victim].end = from;
+            }
+            lock_guard<mutex> guard(blocks[w].lock);
+            blocks[w].next = from;
+            blocks[w].end = to;
+            return true;
+        }
+    };
+
+    auto run = [&](int w) {
+        for (;;) {
+            int item = -1;
+            {
+                lock_guard<mutex> guard(blocks[w].lock);
+                if (blocks[w].next < blocks[w].end) item = blocks[w].next++;
+            }
+            if (item >= 0) {
+                fn(item, w);
+            } else if (!steal(w)) {
+                return;
+            }
+        }
+    };
+
+    if (workers == 1) {
+        run(0);
+        return;
+    }
+    WorkPool::Job job;
+    job.run = run;
+    job.workers = workers;
+    workPool.run(job);
+}
+
+// ------------------------ Fare Table ------------------------
+
+struct FareEntry {
+    int round;  // legs - 1 of the route this fare needs
+    int fare;
+    int prev;   // city before dest on that route
+};
+
+// All-pairs stop-limited fares, precomputed with one sweep per source. A
+// pair's fare only drops as more stops are allowed, so each (src, dest) keeps
+// just the rounds where it improved, in ascending order; a route is then
+// rebuilt by walking prev cities back to src in O(path length).
+class FareTable {
+public:
+    int V = 0;
+    int maxStops = -1;  // -1 until built
+    vector<uint32_t> pairStart;  // entries for (src, dest) at [src * V + dest]
+    vector<FareEntry> entries;
+
+    bool covers(int stops) const {
+        return stops <= maxStops;
+    }
+
+    void build(const Graph &graph, int stops, int workers = workerCount()) {
+        V = graph.V;
+        maxStops = stops;
+
+        vector<vector<FareEntry>> rows(V);
+        vector<vector<uint32_t>> rowCounts(V);
+        vector<vector<int>> slots(workers);
+
+        // One sweep per source; each worker sweeps in its own thread_local
+        // scratch and writes only its sources' rows
+        parallelFor(V, workers, [&](int src, int worker) {
+            vector<int> &slot = slots[worker];
+            ShortestScratch &scratch = graph.sweep(src, maxStops);
+            const vector<HopRecord> &records = scratch.records;
+
+            // Bucket the improvements by city, keeping round order
+            vector<uint32_t> &counts = rowCounts[src];
+            counts.assign(V, 0);
+            for (size_t r = 1; r < records.size(); r++) counts[records[r].city]++;
+            slot.assign(V + 1, 0);
+            for (int v = 0; v < V; v++) slot[v + 1] = slot[v] + counts[v];
+
+            vector<FareEntry> &row = rows[src];
+            row.resize(records.size() - 1);
+            for (size_t r = 1; r < records.size(); r++) {
+                const HopRecord &h = records[r];
+                row[slot[h.city]++] = { h.round, h.fare, records[h.prev].city };
+            }
+            scratch.clearTouched();
+        });
+
+        size_t total = 0;
+        for (const auto &row : rows) total += row.size();
+        if (total > numeric_limits<uint32_t>::max()) {
+            throw runtime_error("fare table too large");
+        }
+
+        pairStart.assign((size_t)V * V + 1, 0);
+        entries.clear();
+        entries.reserve(total);
+        for (int src = 0; src < V; src++) {
+            for (int dest = 0; dest < V; dest++) {
+                size_t i = (size_t)src * V + dest;
+                pairStart[i + 1] = pairStart[i] + rowCounts[src][dest];
+            }
+            entries.insert(entries.end(), rows[src].begin(), rows[src].end());
+            vector<FareEntry>().swap(rows[src]);
+            vector<uint32_t>().swap(rowCounts[src]);
+        }
+    }
+
+    // Same answer as graph.shortest(src, dest, stops) for covered stops
+    pair<int, vector<int>> route(int src, int dest, int stops) const {
+        if (src == dest) {
+            return { 0, {src} };
+        }
+
+        const FareEntry *e = find(src, dest, stops);
+        if (!e) {
+            return { -1, {} };
+        }
+
+        int fare = e->fare;
+        vector<int> path(e->round + 2);
+        int i = e->round + 1;
+        path[i] = dest;
+        while (e->prev != src) {
+            path[--i] = e->prev;
+            e = find(src, e->prev, e->round - 1);
+        }
+        path[0] = src;
+        return { fare, move(path) };
+    }
+
+    size_t memoryBytes() const {
+        return pairStart.capacity() * sizeof(uint32_t) + entries.capacity() * sizeof(FareEntry);
+    }
+
+private:
+    // Cheapest entry for (src, dest) found within `stops` rounds
+    const FareEntry *find(int src, int dest, int stops) const {
+        size_t i = (size_t)src * V + dest;
+        const FareEntry *best = nullptr;
+        for (uint32_t j = pairStart[i]; j < pairStart[i + 1] && entries[j].round <= stops; j++) {
+            best = &entries[j];
+        }
+        return best;
+    }
+};
+
+// ------------------------ City Autocomplete ------------------------
+
+// Radix trie over the lowercased city names, stored in flat arrays with each
+// node's children contiguous. Every node also keeps the MAX_AUTOCOMPLETE
+// best cities below it (most routes first, then by name), so a prefix query
+// is one walk down the trie with no scan of the matching names.
+class AutocompleteIndex {
+public:
+    void build(const vector<string> &cities, const Graph &graph) {
+        names = &cities;
+        degree.assign(cities.size(), 0);
+        for (int c = 0; c < (int)cities.size() && c < graph.V; c++) {
+            degree[c] = graph.offsets[c + 1] - graph.offsets[c];
+        }
+
+        sorted.clear();
+        for (int c = 0; c < (int)cities.size(); c++) {
+            sorted.push_back({ toLowerCase(cities[c]), c });
+        }
+        sort(sorted.begin(), sorted.end());
+        sorted.erase(unique(sorted.begin(), sorted.end(),
+                            [](const auto &a, const auto &b) { return a.first == b.first; }),
+                     sorted.end());
+
+        nodes.assign(1, Node{});
+        labels.clear();
+        top.clear();
+        if (!sorted.empty()) buildNode(0, 0, sorted.size(), 0);
+        vector<pair<string, int>>().swap(sorted);
+    }
+
+    // Best cities whose lowercased name starts with prefix
+    vector<string> complete(const string &prefix, int limit) const {
+        vector<string> result;
+        if (!names || nodes.empty()) return result;
+
+        string q = toLowerCase(prefix);
+        int node = 0;
+        size_t pos = 0;
+        while (pos < q.size()) {
+            const Node &n = nodes[node];
+            int next = -1;
+            for (int c = n.firstChild; c < n.firstChild + n.childCount; c++) {
+                if (labels[nodes[c].labelStart] == q[pos]) {
+                    next = c;
+                    break;
+                }
+            }
+            if (next == -1) return result;
+
+            const Node &child = nodes[next];
+            size_t len = min((size_t)child.labelLen, q.size() - pos);
+            if (labels.compare(child.labelStart, len, q, pos, len) != 0) return result;
+            pos += len;
+            node = next;
+        }
+
+        const Node &n = nodes[node];
+        for (int i = 0; i < min(limit, n.topCount); i++) {
+            result.push_back((*names)[top[n.topStart + i]]);
+        }
+        return result;
+    }
+
+private:
+    struct Node {
+        int labelStart = 0, labelLen = 0;  // edge label in `labels`
+        int firstChild = 0, childCount = 0;
+        int topStart = 0, topCount = 0;    // best cities in `top`
+    };
+
+    // Fill node `id` for sorted[lo, hi), which share their first `depth` chars
+    void buildNode(int id, size_t lo, size_t hi, size_t depth) {
+        const string &first = sorted[lo].first, &last = sorted[hi - 1].first;
+        size_t lcp = depth;
+        // The root keeps an empty label: complete() starts at its children
+        while (id != 0 && lcp < first.size() && lcp < last.size() && first[lcp] == last[lcp]) lcp++;
+
+        nodes[id].labelStart = labels.size();
+        nodes[id].labelLen = lcp - depth;
+        labels.append(first, depth, lcp - depth);
+
+        vector<int> best;
+        if (first.size() == lcp) best.push_back(sorted[lo++].second);
+
+        // Children are the runs of names sharing their next character
+        vector<pair<size_t, size_t>> runs;
+        for (size_t i = lo; i < hi;) {
+            size_t j = i;
+            while (j < hi && sorted[j].first[lcp] == sorted[i].first[lcp]) j++;
+            runs.push_back({ i, j });
+            i = j;
+        }
+        int firstChild = nodes.size();
+        nodes[id].firstChild = firstChild;
+        nodes[id].childCount = runs.size();
+        nodes.resize(nodes.size() + runs.size());
+
+        for (size_t r = 0; r < runs.size(); r++) {
+            int child = firstChild + r;
+            buildNode(child, runs[r].first, runs[r].second, lcp);
+            best.insert(best.end(), top.begin() + nodes[child].topStart,
+                        top.begin() + nodes[child].topStart + nodes[child].topCount);
+        }
+
+        sort(best.begin(), best.end(), [&](int a, int b) {
+            if (degree[a] != degree[b]) return degree[a] > degree[b];
+            return (*names)[a] < (*names)[b];
+        });
+        best.resize(min((int)best.size(), MAX_AUTOCOMPLETE));
+        nodes[id].topStart = top.size();
+        nodes[id].topCount = best.size();
+        top.insert(top.end(), best.begin(), best.end());
+    }
+
+    const vector<string> *names = nullptr;
+    vector<int> degree;
+    vector<pair<string, int>> sorted;  // only during build
+    vector<Node> nodes;
+    string labels;
+    vector<int> top;
+};
+
+// ------------------------ Search Cache ------------------------
+
+// Serialized /search responses keyed by the resolved query. The key packs
+// src and dest (24 bits each), maxStops (6), k (6) and multiple (1).
+inline uint64_t searchCacheKey(int src, int dest, int maxStops, bool multiple, int k) {
+    return (uint64_t)src << 40 | (uint64_t)dest << 16 | (uint64_t)maxStops << 10 |
+           (uint64_t)(multiple ? k : 0) << 1 | (multiple ? 1 : 0);
+}
+
+// Bounded LRU cache split into independently locked shards. Entries are
+// tagged with the generation of the network they were computed on and only
+// hit for that generation, so publishing a new network atomically retires
+// every older entry (they are dropped lazily or by LRU eviction).
+class SearchCache {
+public:
+    struct Hit {
+        shared_ptr<const string> body;
+        int status;
+    };
+
+    void setCapacity(size_t entries) {
+        perShard = (entries + SHARDS - 1) / SHARDS;
+        for (auto &shard : shards) {
+            lock_guard<mutex> lock(shard.mtx);
+            shard.items.clear();
+            shard.index.clear();
+        }
+    }
+
+    // false with --cache 0; such searches are logged as cache "none"
+    bool enabled() const { return perShard != 0; }
+
+    bool get(uint64_t key, uint64_t gen, Hit &hit) {
+        Shard &shard = shardFor(key);
+        {
+            lock_guard<mutex> lock(shard.mtx);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                if (it->second->generation == gen) {
+                    shard.items.splice(shard.items.begin(), shard.items, it->second);
+                    hit = { it->second->body, it->second->status };
+                    hits.fetch_add(1, memory_order_relaxed);
+                    return true;
+                }
+                shard.items.erase(it->second);
+                shard.index.erase(it);
+            }
+        }
+        misses.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    void put(uint64_t key, uint64_t gen, string body, int status) {
+        if (perShard == 0) return;
+        Shard &shard = shardFor(key);
+        auto entry = make_shared<const string>(move(body));
+
+        lock_guard<mutex> lock(shard.mtx);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.items.erase(it->second);
+            shard.index.erase(it);
+        }
+        shard.items.push_front({ key, gen, status, entry });
+        shard.index[key] = shard.items.begin();
+        while (shard.items.size() > perShard) {
+            shard.index.erase(shard.items.back().key);
+            shard.items.pop_back();
+        }
+    }
+
+    json stats() {
+        size_t entries = 0;
+        for (auto &shard : shards) {
+            lock_guard<mutex> lock(shard.mtx);
+            entries += shard.items.size();
+        }
+        return {
+            {"hits", hits.load()},
+            {"misses", misses.load()},
+            {"entries", entries},
+            {"capacity", perShard * SHARDS}
+        };
+    }
+
+private:
+    static const int SHARDS = 16;
+
+    struct Entry {
+        uint64_t key;
+        uint64_t generation;
+        int status;
+        shared_ptr<const string> body;
+    };
+
+    struct Shard {
+        mutex mtx;
+        list<Entry> items;
+        unordered_map<uint64_t, list<Entry>::iterator> index;
+    };
+
+    Shard &shardFor(uint64_t key) {
+        return shards[(key * 0x9E3779B97F4A7C15ull) >> 60];
+    }
+
+    Shard shards[SHARDS];
+    size_t perShard = 0;
+    atomic<uint64_t> hits{0}, misses{0};
+};
+
+// ------------------------ Compute Executor ------------------------
+
+// Fixed set of threads that run searches, apart from httplib's connection
+// workers. Beyond the tasks idle threads are about to take, at most
+// `queueLimit` wait; submit() refuses more so the caller can shed load, and
+// a limit of 0 still runs a task whenever a thread is free. A task still queued at its deadline is called with
+// expired = true instead of running.
+class ComputeExecutor {
+public:
+    using Task = function<void(bool expired)>;
+
+    ~ComputeExecutor() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : threads) t.join();
+    }
+
+    void start(int threadCount, size_t maxQueued) {
+        queueLimit = maxQueued;
+        for (int i = 0; i < threadCount; i++) threads.emplace_back([this] { work(); });
+    }
+
+    // false when the queue is full. Without started threads the task runs
+    // inline, which keeps tools that include this file single-threaded.
+    bool submit(Task task, chrono::steady_clock::time_point deadline) {
+        if (threads.empty()) {
+            task(false);
+            return true;
+        }
+        {
+            lock_guard<mutex> lock(mtx);
+            if (queue.size() >= idle + queueLimit) {
+                rejected++;
+                return false;
+            }
+            queue.push_back({ move(task), deadline });
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    json stats() {
+        lock_guard<mutex> lock(mtx);
+        return {
+            {"threads", threads.size()},
+            {"queueLimit", queueLimit},
+            {"queued", queue.size()},
+            {"idle", idle},
+            {"running", running},
+            {"completed", completed},
+            {"rejected", rejected},
+            {"expired", expired}
+        };
+    }
+
+private:
+    struct Pending {
+        Task task;
+        chrono::steady_clock::time_point deadline;
+    };
+
+    void work() {
+        unique_lock<mutex> lock(mtx);
+        for (;;) {
+            idle++;
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            idle--;
+            if (stopping) return;
+
+            Pending next = move(queue.front());
+            queue.pop_front();
+            bool late = chrono::steady_clock::now() >= next.deadline;
+            late ? expired++ : running++;
+            lock.unlock();
+
+            next.task(late);
+
+            lock.lock();
+            if (!late) {
+                running--;
+                completed++;
+            }
+        }
+    }
+
+    vector<thread> threads;
+    mutex mtx;
+    condition_variable wake;
+    deque<Pending> queue;
+    size_t queueLimit = DEFAULT_COMPUTE_QUEUE;
+    size_t idle = 0;  // threads waiting for a task
+    bool stopping = false;
+    uint64_t running = 0, completed = 0, rejected = 0, expired = 0;
+};
+
+// ------------------------ Metrics ------------------------
+
+// Request counters and latency histograms for /metrics. Every thread that
+// records gets its own shard, which only that thread writes (plain load +
+// store on relaxed atomics, no read-modify-write), so recording never
+// contends; a scrape sums the shards. Latency buckets are log-spaced with
+// two per power of two, from 1 us to about 67 s.
+class RequestMetrics {
+public:
+    static const int ENDPOINTS = 10;
+    static const int LATENCY_BUCKETS = 53;
+
+    static constexpr const char *endpointNames[ENDPOINTS] = {
+        "/", "/cities", "/autocomplete", "/search", "/search/batch", "/from",
+        "/health", "/reload", "/metrics", "other"
+    };
+
+    // Routes -> endpoint label; unknown paths share "other" so a scan of
+    // random URLs cannot grow the label set
+    static int endpointOf(const string &path) {
+        if (path.rfind("/from/", 0) == 0) return 5;
+        for (int e = 0; e < ENDPOINTS - 1; e++) {
+            if (path == endpointNames[e]) return e;
+        }
+        return ENDPOINTS - 1;
+    }
+
+    // Upper bound of latency bucket i in nanoseconds
+    static uint64_t bucketBound(int i) {
+        uint64_t octave = 1000ull << (i / 2);
+        return i % 2 == 0 ? octave : octave + octave / 2;
+    }
+
+    void record(int endpoint, int status, uint64_t nanos) {
+        Shard &shard = localShard();
+        if (status >= 100 && status < 600) bump(shard.statuses[endpoint][status - 100]);
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS && nanos > bucketBound(bucket)) bucket++;
+        bump(shard.latency[endpoint][bucket]);
+        auto &sum = shard.latencySum[endpoint];
+        sum.store(sum.load(memory_order_relaxed) + nanos, memory_order_relaxed);
+    }
+
+    // Prometheus text exposition of the merged shards
+    void write(string &out) {
+        vector<uint64_t> statuses(ENDPOINTS * 500, 0), latency(ENDPOINTS * (LATENCY_BUCKETS + 1), 0);
+        vector<uint64_t> sums(ENDPOINTS, 0);
+        {
+            lock_guard<mutex> lock(shardsMutex);
+            for (const auto &shard : shards) {
+                for (int e = 0; e < ENDPOINTS; e++) {
+                    for (int c = 0; c < 500; c++) {
+                        statuses[e * 500 + c] += shard->statuses[e][c].load(memory_order_relaxed);
+                    }
+                    for (int b = 0; b <= LATENCY_BUCKETS; b++) {
+                        latency[e * (LATENCY_BUCKETS + 1) + b] += shard->latency[e][b].load(memory_order_relaxed);
+                    }
+                    sums[e] += shard->latencySum[e].load(memory_order_relaxed);
+                }
+            }
+        }
+
+        char line[512];
+        out += "# HELP flightfare_requests_total Requests served, by endpoint and HTTP status.\n"
+               "# TYPE flightfare_requests_total counter\n";
+        for (int e = 0; e < ENDPOINTS; e++) {
+            for (int c = 0; c < 500; c++) {
+                if (statuses[e * 500 + c] == 0) continue;
+                snprintf(line, sizeof(line), "flightfare_requests_total{endpoint=\"%s\",status=\"%d\"} %llu\n",
+                         endpointNames[e], c + 100, (unsigned long long)statuses[e * 500 + c]);
+                out += line;
+            }
+        }
+
+        out += "# HELP flightfare_request_duration_seconds Time from routing to response written.\n"
+               "# TYPE flightfare_request_duration_seconds histogram\n";
+        for (int e = 0; e < ENDPOINTS; e++) {
+            const uint64_t *buckets = &latency[e * (LATENCY_BUCKETS + 1)];
+            uint64_t count = 0;
+            for (int b = 0; b <= LATENCY_BUCKETS; b++) count += buckets[b];
+            if (count == 0) continue;
+
+            uint64_t cumulative = 0;
+            for (int b = 0; b < LATENCY_BUCKETS; b++) {
+                cumulative += buckets[b];
+                snprintf(line, sizeof(line),
+                         "flightfare_request_duration_seconds_bucket{endpoint=\"%s\",le=\"%g\"} %llu\n",
+                         endpointNames[e], bucketBound(b) / 1e9, (unsigned long long)cumulative);
+                out += line;
+            }
+            snprintf(line, sizeof(line),
+                     "flightfare_request_duration_seconds_bucket{endpoint=\"%s\",le=\"+Inf\"} %llu\n"
+                     "flightfare_request_duration_seconds_sum{endpoint=\"%s\"} %.9f\n"
+                     "flightfare_request_duration_seconds_count{endpoint=\"%s\"} %llu\n",
+                     endpointNames[e], (unsigned long long)count, endpointNames[e], sums[e] / 1e9,
+                     endpointNames[e], (unsigned long long)count);
+            out += line;
+        }
+    }
+
+private:
+    struct Shard {
+        atomic<uint64_t> statuses[ENDPOINTS][500] = {};
+        atomic<uint64_t> latency[ENDPOINTS][LATENCY_BUCKETS + 1] = {};  // last: beyond the top bound
+        atomic<uint64_t> latencySum[ENDPOINTS] = {};                   // nanoseconds
+    };
+
+    static void bump(atomic<uint64_t> &counter) {
+        counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+
+    // Shards live as long as the process, so a scrape never races a
+    // thread's exit
+    Shard &localShard() {
+        thread_local Shard *shard = nullptr;
+        if (!shard) {
+            lock_guard<mutex> lock(shardsMutex);
+            shards.push_back(make_unique<Shard>());
+            shard = shards.back().get();
+        }
+        return *shard;
+    }
+
+    mutex shardsMutex;
+    vector<unique_ptr<Shard>> shards;
+};
+
+RequestMetrics requestMetrics;
+
+// ------------------------ Data Management ------------------------
+
+// Case-insensitive map from city names (and aliases) to ids. Open addressing
+// with linear probing over a power-of-two slot array; keys are stored
+// lowercased in one arena and looked up by string_view, folding case while
+// hashing and comparing, so resolving a name never allocates.
+class CityMap {
+public:
+    // Id of `name` ignoring ASCII case, or -1
+    int find(string_view name) const {
+        if (slots.empty()) return -1;
+        uint32_t h = hashKey(name);
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            const Slot &slot = slots[i];
+            if (slot.id < 0) return -1;
+            if (slot.hash == h && keyEquals(slot, name)) return slot.id;
+        }
+    }
+
+    // Lookup shorthand for names known to be present
+    int operator[](string_view name) const { return find(name); }
+
+    // Add `name` -> `id`; false (and no change) if the name is already mapped
+    bool insert(string_view name, int id) {
+        if ((count + 1) * 2 > slots.size()) grow();
+        uint32_t h = hashKey(name);
+        size_t i = h & mask;
+        for (; slots[i].id >= 0; i = (i + 1) & mask) {
+            if (slots[i].hash == h && keyEquals(slots[i], name)) return false;
+        }
+        slots[i] = { h, id, (uint32_t)keys.size(), (uint32_t)name.size() };
+        for (char c : name) keys.push_back(lower(c));
+        count++;
+        return true;
+    }
+
+    size_t size() const { return count; }
+
+    void clear() {
+        slots.clear();
+        keys.clear();
+        count = 0;
+        mask = 0;
+    }
+
+private:
+    struct Slot {
+        uint32_t hash;
+        int id = -1;  // -1 marks an empty slot
+        uint32_t keyStart, keyLength;
+    };
+
+    static char lower(char c) { return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c; }
+
+    static uint32_t hashKey(string_view s) {
+        uint32_t h = 2166136261u;  // FNV-1a over the lowercased bytes
+        for (char c : s) {
+            h = (h ^ (unsigned char)lower(c)) * 16777619u;
+        }
+        return h;
+    }
+
+    bool keyEquals(const Slot &slot, string_view name) const {
+        if (slot.keyLength != name.size()) return false;
+        const char *key = keys.data() + slot.keyStart;
+        for (size_t i = 0; i < name.size(); i++) {
+            if (key[i] != lower(name[i])) return false;
+        }
+        return true;
+    }
+
+    void grow() {
+        vector<Slot> old = move(slots);
+        slots.assign(max<size_t>(16, old.size() * 2), Slot{});
+        mask = slots.size() - 1;
+        for (const Slot &slot : old) {
+            if (slot.id < 0) continue;
+            size_t i = slot.hash & mask;
+            while (slots[i].id >= 0) i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    vector<Slot> slots;
+    string keys;
+    size_t count = 0;
+    size_t mask = 0;
+};
+
+// Everything a search reads, immutable once published. Handlers hold a
+// shared_ptr to the network that was current when they started, so a reload
+// never changes data under an in-flight search.
+struct Network {
+    vector<string> idToCity;
+    CityMap cityMap;                     // names and aliases, any case
+    vector<pair<string, int>> aliases;   // IATA codes, former names, ...
+    SuggestionIndex suggestions;
+    AutocompleteIndex autocomplete;
+    Graph graph;
+    FareTable fareTable;
+    uint64_t generation = 0;
+};
+
+// Where the network comes from, so /reload can rebuild it the same way
+struct NetworkSource {
+    string dataFile;
+    string snapshotFile;
+    string aliasesFile;
+    int precomputeStops = -1;
+};
+
+shared_ptr<const Network> network;
+NetworkSource networkSource;
+atomic<uint64_t> networkGeneration{0};
+mutex reloadMutex;
+SearchCache searchCache;
+ComputeExecutor computePool;
+int searchDeadlineMs = DEFAULT_SEARCH_DEADLINE_MS;
+int searchBudgetMs = DEFAULT_SEARCH_BUDGET_MS;
+long long maxSpurSearches = DEFAULT_MAX_SPUR_SEARCHES;
+string reloadToken;  // --reload-token; empty: loopback clients only
+
+shared_ptr<const Network> currentNetwork() {
+    return atomic_load(&network);
+}
+
+// Swap in a fully built network. Searches already running keep the old one
+// alive until they finish; cached responses of older generations stop hitting.
+void publishNetwork(shared_ptr<Network> next) {
+    next->generation = ++networkGeneration;
+    atomic_store(&network, shared_ptr<const Network>(move(next)));
+}
+
+// Precompute an all-pairs fare table covering up to `stops` stops
+void buildFareTable(Network &net, int stops) {
+    FareTable &fareTable = net.fareTable;
+    auto start = chrono::steady_clock::now();
+    fareTable.build(net.graph, stops);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "✓ Precomputed fare table for up to " << stops << " stops: "
+         << fixed << setprecision(1) << fareTable.memoryBytes() / (1024.0 * 1024.0) << " MB, "
+         << fareTable.entries.size() << " entries in " << setprecision(0) << seconds * 1000 << " ms ("
+         << net.graph.V / max(seconds, 1e-9) << " sources/s on " << min(workerCount(), max(net.graph.V, 1))
+         << " threads)" << endl;
+}
+
+// Make `alias` resolve to `city`; names and earlier aliases take precedence
+void addAlias(Network &net, const string &alias, int city) {
+    if (net.cityMap.insert(alias, city)) {
+        net.aliases.push_back({ alias, city });
+    }
+}
+
+shared_ptr<Network> initData() {
+    auto net = make_shared<Network>();
+    vector<string> &idToCity = net->idToCity;
+    CityMap &cityMap = net->cityMap;
+    Graph &g = net->graph;
+
+    idToCity = {
+        "Delhi", "Mumbai", "Goa", "Chennai", "Jaipur",
+        "Bangalore", "Kolkata", "Hyderabad", "Pune", "Ahmedabad",
+        "Kochi", "Varanasi", "Amritsar", "Lucknow", "Chandigarh", "Patna"
+    };
+
+    cityMap.clear();
+    for (size_t i = 0; i < idToCity.size(); i++) {
+        cityMap.insert(idToCity[i], i);
+    }
+
+    g = Graph(idToCity.size());
+
+    // Define bidirectional routes (more realistic)
+    g.addBidirectionalEdge(cityMap["delhi"], cityMap["mumbai"], 5000);
+    g.addBidirectionalEdge(cityMap["delhi"], cityMap["goa"], 7000);
+    g.addBidirectionalEdge(cityMap["delhi"], cityMap["bangalore"], 6500);
+    g.addBidirectionalEdge(cityMap["delhi"], cityMap["kolkata"], 5500);
+    g.addBidirectionalEdge(cityMap["delhi"], cityMap["jaipur"], 3000);
     g.addBidirectionalEdge(cityMap["delhi"], cityMap["chandigarh"], 2500);
     g.addBidirectionalEdge(cityMap["delhi"], cityMap["lucknow"], 3500);
     g.addBidirectionalEdge(cityMap["delhi"], cityMap["amritsar"], 4000);
 
-    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["chennai"], 5500);
-    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["goa"], 3000);
-    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["pune"], 1500);
-    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["ahmedabad"], 4000);
+    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["chennai"], 5500);
+    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["goa"], 3000);
+    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["pune"], 1500);
+    g.addBidirectionalEdge(cityMap["mumbai"], cityMap["ahmedabad"], 4000);
+
+    g.addBidirectionalEdge(cityMap["goa"], cityMap["chennai"], 4500);
+    g.addBidirectionalEdge(cityMap["goa"], cityMap["bangalore"], 3500);
+    g.addBidirectionalEdge(cityMap["goa"], cityMap["kochi"], 4000);
+
+    g.addBidirectionalEdge(cityMap["chennai"], cityMap["hyderabad"], 2500);
+    g.addBidirectionalEdge(cityMap["chennai"], cityMap["bangalore"], 2000);
+    g.addBidirectionalEdge(cityMap["chennai"], cityMap["kochi"], 3500);
+
+    g.addBidirectionalEdge(cityMap["bangalore"], cityMap["hyderabad"], 3000);
+    g.addBidirectionalEdge(cityMap["bangalore"], cityMap["pune"], 4000);
+    g.addBidirectionalEdge(cityMap["bangalore"], cityMap["kochi"], 3000);
+
+    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["chennai"], 6000);
+    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["hyderabad"], 5500);
+    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["varanasi"], 3500);
+    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["lucknow"], 4500);
+    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["patna"], 2500);
+
+    g.addBidirectionalEdge(cityMap["jaipur"], cityMap["ahmedabad"], 3500);
+    g.addBidirectionalEdge(cityMap["jaipur"], cityMap["mumbai"], 4500);
+
+    g.addBidirectionalEdge(cityMap["hyderabad"], cityMap["pune"], 2200);
+    g.addBidirectionalEdge(cityMap["pune"], cityMap["ahmedabad"], 3500);
+    g.addBidirectionalEdge(cityMap["ahmedabad"], cityMap["delhi"], 4500);
+
+    g.addBidirectionalEdge(cityMap["varanasi"], cityMap["lucknow"], 2000);
+    g.addBidirectionalEdge(cityMap["varanasi"], cityMap["patna"], 1500);
+    g.addBidirectionalEdge(cityMap["lucknow"], cityMap["chandigarh"], 4000);
+    g.addBidirectionalEdge(cityMap["lucknow"], cityMap["patna"], 2800);
+    g.addBidirectionalEdge(cityMap["chandigarh"], cityMap["amritsar"], 2500);
+    g.addBidirectionalEdge(cityMap["patna"], cityMap["delhi"], 4800);
+
+    g.freeze();
+
+    // IATA codes and former names
+    const vector<pair<string, string>> builtInAliases = {
+        {"DEL", "Delhi"}, {"BOM", "Mumbai"}, {"Bombay", "Mumbai"}, {"GOI", "Goa"},
+        {"MAA", "Chennai"}, {"Madras", "Chennai"}, {"JAI", "Jaipur"},
+        {"BLR", "Bangalore"}, {"Bengaluru", "Bangalore"}, {"CCU", "Kolkata"},
+        {"Calcutta", "Kolkata"}, {"HYD", "Hyderabad"}, {"PNQ", "Pune"}, {"Poona", "Pune"},
+        {"AMD", "Ahmedabad"}, {"COK", "Kochi"}, {"Cochin", "Kochi"}, {"VNS", "Varanasi"},
+        {"Benares", "Varanasi"}, {"Banaras", "Varanasi"}, {"ATQ", "Amritsar"},
+        {"LKO", "Lucknow"}, {"IXC", "Chandigarh"}, {"PAT", "Patna"}
+    };
+    for (const auto &[alias, city] : builtInAliases) {
+        addAlias(*net, alias, cityMap[city]);
+    }
+
+    cout << "✓ Loaded " << idToCity.size() << " cities and routes" << endl;
+    return net;
+}
+
+// Trim spaces, tabs and a trailing carriage return from a field
+string_view trimField(string_view s) {
+    size_t a = s.find_first_not_of(" \t\r");
+    if (a == string_view::npos) return {};
+    size_t b = s.find_last_not_of(" \t\r");
+    return s.substr(a, b - a + 1);
+}
+
+// Parse one leg file line into `legs`, registering new cities on the way
+bool parseLegLine(string_view line, char delim, Network &net,
+                  vector<tuple<int, int, int, bool>> &legs) {
+    string_view fields[4];
+    int count = 0;
+    while (count < 4) {
+        size_t cut = line.find(delim);
+        fields[count++] = trimField(line.substr(0, cut));
+        if (cut == string_view::npos) break;
+        line.remove_prefix(cut + 1);
+    }
+    if (count < 3 || fields[0].empty() || fields[1].empty()) return false;
+
+    int fare;
+    auto [end, ec] = from_chars(fields[2].data(), fields[2].data() + fields[2].size(), fare);
+    if (ec != errc() || end != fields[2].data() + fields[2].size() || fare < 0 || fare > MAX_FARE) {
+        return false;
+    }
+
+    bool oneWay = false;
+    if (count == 4 && !fields[3].empty()) {
+        char c = fields[3][0];
+        oneWay = c == '1' || c == 'y' || c == 'Y' || c == 't' || c == 'T';
+    }
+
+    int ids[2];
+    for (int i = 0; i < 2; i++) {
+        ids[i] = net.cityMap.find(fields[i]);
+        if (ids[i] < 0) {
+            ids[i] = (int)net.idToCity.size();
+            net.cityMap.insert(fields[i], ids[i]);
+            net.idToCity.emplace_back(fields[i]);
+        }
+    }
+
+    legs.emplace_back(ids[0], ids[1], fare, oneWay);
+    return true;
+}
+
+// Load the route network from a CSV or TSV leg file with lines of
+// origin, destination, fare[, oneway]. Legs are bidirectional unless the
+// oneway column starts with 1/y/t. Blank lines and '#' comments are skipped,
+// as is a header on line 1. The file is read in fixed-size blocks and parsed in
+// place.
+shared_ptr<Network> loadRoutesFile(const string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        throw runtime_error("cannot open " + path);
+    }
+    unique_ptr<FILE, int (*)(FILE *)> closer(file, fclose);
+
+    auto net = make_shared<Network>();
+    vector<tuple<int, int, int, bool>> legs;
+
+    const size_t BLOCK = 1 << 20;
+    vector<char> buffer(BLOCK);
+    size_t carry = 0;
+    long lineNo = 0;
+    char delim = 0;
+    bool eof = false;
+
+    while (!eof) {
+        if (carry == buffer.size()) buffer.resize(buffer.size() * 2);
+        size_t got = fread(buffer.data() + carry, 1, buffer.size() - carry, file);
+        eof = got == 0;
+        size_t size = carry + got;
+        size_t pos = 0;
+
+        while (pos < size) {
+            const char *start = buffer.data() + pos;
+            const char *nl = (const char *)memchr(start, '\n', size - pos);
+            if (!nl && !eof) break;  // partial line, finish it with the next block
+            size_t len = nl ? (size_t)(nl - start) : size - pos;
+            pos += len + (nl ? 1 : 0);
+            lineNo++;
+
+            string_view line = trimField(string_view(start, len));
+            if (line.empty() || line[0] == '#') continue;
+            if (!delim) delim = line.find('\t') != string_view::npos ? '\t' : ',';
+
+            if (!parseLegLine(line, delim, *net, legs)) {
+                if (lineNo == 1) continue;  // header
+                throw runtime_error(path + ":" + to_string(lineNo) + ": invalid leg (fare must be 0-" +
+                                    to_string(MAX_FARE) + "): " + string(line));
+            }
+        }
+
+        carry = size - pos;
+        memmove(buffer.data(), buffer.data() + pos, carry);
+    }
+
+    Graph &g = net->graph;
+    g = Graph(net->idToCity.size());
+    for (const auto &[u, v, fare, oneWay] : legs) {
+        if (oneWay) g.addEdge(u, v, fare);
+        else g.addBidirectionalEdge(u, v, fare);
+    }
+    g.freeze();
+
+    cout << "✓ Loaded " << net->idToCity.size() << " cities and " << legs.size()
+         << " legs from " << path << endl;
+    return net;
+}
+
+// Read "alias,city" (or tab-separated) lines into the network's aliases.
+// Blank lines, '#' comments and a header line are skipped.
+void loadAliasesFile(Network &net, const string &path) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("cannot open " + path);
+    }
+
+    string line;
+    long lineNo = 0;
+    size_t before = net.aliases.size();
+    while (getline(in, line)) {
+        lineNo++;
+        string_view text = trimField(line);
+        if (text.empty() || text[0] == '#') continue;
+
+        size_t cut = text.find('\t') != string_view::npos ? text.find('\t') : text.find(',');
+        string alias(trimField(text.substr(0, cut)));
+        int city = cut == string_view::npos ? -1 : net.cityMap.find(trimField(text.substr(cut + 1)));
+        if (alias.empty() || city < 0) {
+            if (lineNo == 1) continue;  // header
+            throw runtime_error(path + ":" + to_string(lineNo) + ": unknown city in alias: " + string(text));
+        }
+        addAlias(net, alias, city);
+    }
+
+    cout << "✓ Loaded " << net.aliases.size() - before << " aliases from " << path << endl;
+}
+
+// ------------------------ Network Snapshot ------------------------
+
+// Read-only memory mapping of a whole file, shared with other processes
+// through the page cache.
+class MappedFile {
+public:
+    explicit MappedFile(const string &path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw runtime_error("cannot open " + path);
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = (size_t)fileSize.QuadPart;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            throw runtime_error("cannot map " + path);
+        }
+        bytes = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!bytes) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            throw runtime_error("cannot map " + path);
+        }
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            throw runtime_error("cannot map " + path);
+        }
+        length = (size_t)st.st_size;
+        void *addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) throw runtime_error("cannot map " + path);
+        bytes = (const char *)addr;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        UnmapViewOfFile(bytes);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap((void *)bytes, length);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+const char SNAPSHOT_MAGIC[8] = { 'F', 'F', 'S', 'N', 'A', 'P', 0, 0 };
+const uint32_t SNAPSHOT_VERSION = 1;
 
-    g.addBidirectionalEdge(cityMap["goa"], cityMap["chennai"], 4500);
-    g.addBidirectionalEdge(cityMap["goa"], cityMap["bangalore"], 3500);
-    g.addBidirectionalEdge(cityMap["goa"], cityMap["kochi"], 4000);
+// On-disk layout of a network snapshot, in native byte order. Section
+// positions are byte offsets from the start of the file, 8-byte aligned.
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t cityCount;
+    uint64_t edgeCount;
+    uint64_t fileSize;
+    uint64_t nameStartAt;  // uint32_t[cityCount + 1] into the name bytes
+    uint64_t namesAt;      // display names, back to back
+    uint64_t offsetsAt;    // int32_t[cityCount + 1], CSR offsets
+    uint64_t edgeToAt;     // int32_t[edgeCount]
+    uint64_t edgeCostAt;   // int32_t[edgeCount]
+};
 
-    g.addBidirectionalEdge(cityMap["chennai"], cityMap["hyderabad"], 2500);
-    g.addBidirectionalEdge(cityMap["chennai"], cityMap["bangalore"], 2000);
-    g.addBidirectionalEdge(cityMap["chennai"], cityMap["kochi"], 3500);
+// Write a network's city names and frozen graph as a snapshot
+void writeSnapshot(const Network &net, const string &path) {
+    const vector<string> &idToCity = net.idToCity;
+    const Graph &g = net.graph;
+    uint32_t V = idToCity.size();
+    uint64_t E = g.edgeCount();
+    auto align = [](uint64_t n) { return (n + 7) & ~uint64_t(7); };
 
-    g.addBidirectionalEdge(cityMap["bangalore"], cityMap["hyderabad"], 3000);
-    g.addBidirectionalEdge(cityMap["bangalore"], cityMap["pune"], 4000);
-    g.addBidirectionalEdge(cityMap["bangalore"], cityMap["kochi"], 3000);
+    vector<uint32_t> nameStart(V + 1, 0);
+    for (uint32_t i = 0; i < V; i++) nameStart[i + 1] = nameStart[i] + idToCity[i].size();
 
-    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["chennai"], 6000);
-    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["hyderabad"], 5500);
-    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["varanasi"], 3500);
-    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["lucknow"], 4500);
-    g.addBidirectionalEdge(cityMap["kolkata"], cityMap["patna"], 2500);
+    SnapshotHeader h = {};
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.cityCount = V;
+    h.edgeCount = E;
+    h.nameStartAt = align(sizeof(SnapshotHeader));
+    h.namesAt = align(h.nameStartAt + sizeof(uint32_t) * (V + 1));
+    h.offsetsAt = align(h.namesAt + nameStart[V]);
+    h.edgeToAt = align(h.offsetsAt + sizeof(int32_t) * (V + 1));
+    h.edgeCostAt = align(h.edgeToAt + sizeof(int32_t) * E);
+    h.fileSize = align(h.edgeCostAt + sizeof(int32_t) * E);
 
-    g.addBidirectionalEdge(cityMap["jaipur"], cityMap["ahmedabad"], 3500);
-    g.addBidirectionalEdge(cityMap["jaipur"], cityMap["mumbai"], 4500);
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        throw runtime_error("cannot create " + path);
+    }
+    unique_ptr<FILE, int (*)(FILE *)> closer(file, fclose);
 
-    g.addBidirectionalEdge(cityMap["hyderabad"], cityMap["pune"], 2200);
-    g.addBidirectionalEdge(cityMap["pune"], cityMap["ahmedabad"], 3500);
-    g.addBidirectionalEdge(cityMap["ahmedabad"], cityMap["delhi"], 4500);
+    uint64_t written = 0;
+    auto put = [&](uint64_t at, const void *data, size_t size) {
+        static const char zeros[8] = {};
+        fwrite(zeros, 1, at - written, file);
+        fwrite(data, 1, size, file);
+        written = at + size;
+    };
+    put(0, &h, sizeof(h));
+    put(h.nameStartAt, nameStart.data(), sizeof(uint32_t) * (V + 1));
+    put(h.namesAt, "", 0);
+    for (const auto &name : idToCity) {
+        fwrite(name.data(), 1, name.size(), file);
+    }
+    written += nameStart[V];
+    put(h.offsetsAt, g.offsets, sizeof(int32_t) * (V + 1));
+    put(h.edgeToAt, g.edgeTo, sizeof(int32_t) * E);
+    put(h.edgeCostAt, g.edgeCost, sizeof(int32_t) * E);
+    put(h.fileSize, "", 0);
 
-    g.addBidirectionalEdge(cityMap["varanasi"], cityMap["lucknow"], 2000);
-    g.addBidirectionalEdge(cityMap["varanasi"], cityMap["patna"], 1500);
-    g.addBidirectionalEdge(cityMap["lucknow"], cityMap["chandigarh"], 4000);
-    g.addBidirectionalEdge(cityMap["lucknow"], cityMap["patna"], 2800);
-    g.addBidirectionalEdge(cityMap["chandigarh"], cityMap["amritsar"], 2500);
-    g.addBidirectionalEdge(cityMap["patna"], cityMap["delhi"], 4800);
+    if (ferror(file)) {
+        throw runtime_error("cannot write " + path);
+    }
+    cout << "✓ Wrote snapshot of " << V << " cities and " << E << " legs to " << path << endl;
+}
 
-    cout << "✓ Loaded " << idToCity.size() << " cities and routes" << endl;
+// Map a snapshot and use its edge arrays in place as the graph. Only the
+// header and section bounds are checked, so startup does not touch the edge
+// pages; idToCity and cityMap are rebuilt from the (small) city name table.
+shared_ptr<Network> loadSnapshot(const string &path) {
+    auto file = make_shared<MappedFile>(path);
+    const char *base = file->data();
+
+    SnapshotHeader h;
+    if (file->size() < sizeof(h)) {
+        throw runtime_error(path + ": not a network snapshot");
+    }
+    memcpy(&h, base, sizeof(h));
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) {
+        throw runtime_error(path + ": not a network snapshot");
+    }
+    if (h.version != SNAPSHOT_VERSION) {
+        throw runtime_error(path + ": unsupported snapshot version " + to_string(h.version));
+    }
+
+    // Counts are bounded before section sizes are computed from them, and
+    // each section is checked as at <= size && length <= size - at, which
+    // cannot wrap however large the offsets in the header are
+    uint64_t V = h.cityCount, E = h.edgeCount, size = file->size();
+    if (h.fileSize != size || V >= (uint64_t)numeric_limits<int>::max() ||
+        E > (uint64_t)numeric_limits<int>::max()) {
+        throw runtime_error(path + ": corrupt snapshot");
+    }
+    auto section = [size](uint64_t at, uint64_t length, uint64_t align) {
+        return at % align == 0 && at <= size && length <= size - at;
+    };
+    uint64_t nameStartBytes = sizeof(uint32_t) * (V + 1);
+    uint64_t offsetsBytes = sizeof(int32_t) * (V + 1);
+    uint64_t edgeBytes = sizeof(int32_t) * E;
+    bool fits = section(h.nameStartAt, nameStartBytes, alignof(uint32_t)) &&
+                section(h.namesAt, 0, 1) &&
+                section(h.offsetsAt, offsetsBytes, alignof(int32_t)) &&
+                section(h.edgeToAt, edgeBytes, alignof(int32_t)) &&
+                section(h.edgeCostAt, edgeBytes, alignof(int32_t)) &&
+                h.nameStartAt >= sizeof(h) &&
+                h.nameStartAt + nameStartBytes <= h.namesAt &&
+                h.namesAt <= h.offsetsAt &&
+                h.offsetsAt + offsetsBytes <= h.edgeToAt &&
+                h.edgeToAt + edgeBytes <= h.edgeCostAt;
+    if (!fits) {
+        throw runtime_error(path + ": corrupt snapshot");
+    }
+    const uint32_t *nameStart = (const uint32_t *)(base + h.nameStartAt);
+    const int *offsets = (const int *)(base + h.offsetsAt);
+    if (nameStart[V] > h.offsetsAt - h.namesAt || offsets[0] != 0 || (uint64_t)offsets[V] != E) {
+        throw runtime_error(path + ": corrupt snapshot");
+    }
+
+    // Both tables must be non-decreasing for the names and edge ranges to
+    // stay inside the checked bounds, so they are checked in full before any
+    // name is read; the edge pages are never touched here
+    for (uint64_t i = 0; i < V; i++) {
+        if (nameStart[i + 1] < nameStart[i] || offsets[i + 1] < offsets[i]) {
+            throw runtime_error(path + ": corrupt snapshot");
+        }
+    }
+    auto net = make_shared<Network>();
+    net->idToCity.reserve(V);
+    for (uint64_t i = 0; i < V; i++) {
+        net->idToCity.emplace_back(base + h.namesAt + nameStart[i], nameStart[i + 1] - nameStart[i]);
+        net->cityMap.insert(net->idToCity.back(), i);
+    }
+
+    net->graph.attach(V, E, offsets, (const int *)(base + h.edgeToAt),
+                      (const int *)(base + h.edgeCostAt), file);
+
+    cout << "✓ Mapped " << V << " cities and " << E << " legs from " << path << endl;
+    return net;
+}
+
+// Build a network from the configured source, including its fare table
+shared_ptr<Network> loadNetwork(const NetworkSource &source) {
+    shared_ptr<Network> net;
+    if (!source.snapshotFile.empty()) {
+        net = loadSnapshot(source.snapshotFile);
+    } else if (!source.dataFile.empty()) {
+        net = loadRoutesFile(source.dataFile);
+    } else {
+        net = initData();
+    }
+    if (!source.aliasesFile.empty()) {
+        loadAliasesFile(*net, source.aliasesFile);
+    }
+    net->suggestions.build(net->idToCity, net->aliases);
+    net->autocomplete.build(net->idToCity, net->graph);
+    if (source.precomputeStops >= 0) {
+        buildFareTable(*net, source.precomputeStops);
+    }
+    return net;
 }
 
 // ------------------------ CORS Middleware ------------------------
@@ -305,12 +2479,24 @@ void enableCORS(httplib::Response &res) {
 
 // ------------------------ API Handlers ------------------------
 
+// A JSON number as an int when it lies in [0, max], otherwise -1. The range
+// is checked before narrowing, so that 4294967297 is not read as 1.
+int boundedInt(const json &value, int max) {
+    if (value.is_number_float()) {
+        double n = value.get<double>();
+        return n >= 0 && n <= max ? (int)n : -1;
+    }
+    int64_t n = value.get<int64_t>();
+    return n >= 0 && n <= max ? (int)n : -1;
+}
+
 void handleGetCities(const httplib::Request &req, httplib::Response &res) {
     enableCORS(res);
     
+    auto net = currentNetwork();
     json response;
-    response["cities"] = idToCity;
-    response["totalCities"] = idToCity.size();
+    response["cities"] = net->idToCity;
+    response["totalCities"] = net->idToCity.size();
     
     res.set_content(response.dump(2), "application/json");
     res.status = 200;
@@ -318,9 +2504,245 @@ void handleGetCities(const httplib::Request &req, httplib::Response &res) {
     logRequest("GET", "/cities", 200);
 }
 
+void handleAutocomplete(const httplib::Request &req, httplib::Response &res) {
+    enableCORS(res);
+    auto net = currentNetwork();
+    json response;
+
+    string q = trim(req.get_param_value("q"));
+    int limit = MAX_AUTOCOMPLETE;
+    if (req.has_param("limit")) {
+        limit = atoi(req.get_param_value("limit").c_str());
+    }
+
+    if (limit < 1 || limit > MAX_AUTOCOMPLETE) {
+        response["error"] = "limit must be between 1 and " + to_string(MAX_AUTOCOMPLETE);
+        res.status = 400;
+    } else {
+        response["query"] = q;
+        response["cities"] = net->autocomplete.complete(q, limit);
+        res.status = 200;
+    }
+
+    res.set_content(response.dump(2), "application/json");
+    logRequest("GET", "/autocomplete", res.status);
+}
+
+// GET /from/{city}: cheapest fare to every reachable city. The answer can
+// cover the whole network, so it is streamed in chunks rather than built
+// as one json document.
+void handleFaresFrom(const httplib::Request &req, httplib::Response &res) {
+    enableCORS(res);
+    auto net = currentNetwork();
+    json response;
+
+    string origin = req.matches[1];
+    int src = net->cityMap.find(trimView(origin));
+    int maxStops = DEFAULT_MAX_STOPS;
+    if (req.has_param("maxStops")) {
+        const string &text = req.get_param_value("maxStops");
+        auto [end, ec] = from_chars(text.data(), text.data() + text.size(), maxStops);
+        if (ec != errc() || end != text.data() + text.size()) maxStops = -1;
+    }
+
+    if (maxStops < 0 || maxStops > MAX_STOPS_LIMIT) {
+        response["error"] = "maxStops must be between 0 and " + to_string(MAX_STOPS_LIMIT);
+        res.status = 400;
+    } else if (src < 0) {
+        response["error"] = "Unknown city: " + origin;
+        auto suggestions = net->suggestions.suggest(origin, net->idToCity);
+        if (!suggestions.empty()) {
+            response["suggestions"] = suggestions;
+        }
+        res.status = 400;
+    }
+    if (maxStops < 0 || maxStops > MAX_STOPS_LIMIT || src < 0) {
+        res.set_content(response.dump(2), "application/json");
+        logRequest("GET", "/from", res.status);
+        return;
+    }
+
+    // The sweep runs on the compute pool like /search, under the same queue
+    // limit and deadline; only the streaming stays on this thread
+    struct FaresJob {
+        vector<tuple<int, int, int, int>> fares;
+        int status = 500;
+        promise<void> done;
+    };
+    auto job = make_shared<FaresJob>();
+    auto finished = job->done.get_future();
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(searchDeadlineMs);
+    bool queued = computePool.submit(
+        [job, net, src, maxStops](bool expired) {
+            if (expired) {
+                job->status = 503;
+            } else {
+                try {
+                    job->fares = net->graph.faresFrom(src, maxStops);
+                    job->status = 200;
+                } catch (const exception &) {
+                    job->status = 500;
+                }
+            }
+            job->done.set_value();
+        },
+        deadline);
+
+    if (!queued || finished.wait_until(deadline) != future_status::ready || job->status == 503) {
+        response["error"] = queued ? "Search deadline exceeded" : "Server busy, retry shortly";
+        res.set_header("Retry-After", "1");
+        res.status = 503;
+        res.set_content(response.dump(2), "application/json");
+        logRequest("GET", "/from", 503);
+        return;
+    }
+    if (job->status != 200) {
+        response["error"] = "Internal server error";
+        res.status = 500;
+        res.set_content(response.dump(2), "application/json");
+        logRequest("GET", "/from", 500);
+        return;
+    }
+
+    auto fares = shared_ptr<const vector<tuple<int, int, int, int>>>(job, &job->fares);
+    string head = "{\n  \"origin\": " + json(net->idToCity[src]).dump() +
+                  ",\n  \"maxStops\": " + to_string(maxStops) +
+                  ",\n  \"reachable\": " + to_string(fares->size()) + ",\n  \"fares\": [";
+    auto next = make_shared<size_t>(0);
+
+    res.status = 200;
+    res.set_chunked_content_provider("application/json",
+        [net, fares, head, next](size_t, httplib::DataSink &sink) {
+            const size_t CHUNK_ROWS = 1024;
+            string chunk = *next == 0 ? head : "";
+            size_t end = min(*next + CHUNK_ROWS, fares->size());
+            for (; *next < end; ++*next) {
+                auto [city, fare, legs, prev] = (*fares)[*next];
+                chunk += *next == 0 ? "\n    " : ",\n    ";
+                chunk += "{\"city\": " + json(net->idToCity[city]).dump() +
+                         ", \"fare\": " + to_string(fare) + ", \"stops\": " + to_string(legs) +
+                         ", \"parent\": " + json(net->idToCity[prev]).dump() + "}";
+            }
+            if (*next == fares->size()) {
+                chunk += fares->empty() ? "]\n}" : "\n  ]\n}";
+                sink.write(chunk.data(), chunk.size());
+                sink.done();
+            } else {
+                sink.write(chunk.data(), chunk.size());
+            }
+            return true;
+        });
+    logRequest("GET", "/from", 200);
+}
+
+// One JSON Lines record of the /search access log
+struct SearchRecord {
+    int64_t time;
+    int32_t status = 0;
+    int32_t src = -1, dest = -1;  // -1 until resolved
+    int32_t maxStops = -1, k = -1;
+    bool multiple = false;
+    char cache = '-';  // 'h' hit, 'm' miss, '-' not consulted
+    int32_t queuePeak = 0;
+    int64_t verticesExpanded = 0, edgesRelaxed = 0;
+    int64_t micros = 0, bytes = 0;
+
+    void format(const char *timestamp, string &out) const {
+        const char *outcome = cache == 'h' ? "hit" : cache == 'm' ? "miss" : "none";
+        char line[384];
+        int n = snprintf(line, sizeof(line),
+                         "{\"ts\":\"%s\",\"status\":%d,\"src\":%d,\"dest\":%d,\"maxStops\":%d,"
+                         "\"multiple\":%s,\"k\":%d,\"cache\":\"%s\",\"verticesExpanded\":%lld,"
+                         "\"edgesRelaxed\":%lld,\"queuePeak\":%d,\"us\":%lld,\"bytes\":%lld}\n",
+                         timestamp, (int)status, (int)src, (int)dest, (int)maxStops,
+                         multiple ? "true" : "false", (int)k, outcome, (long long)verticesExpanded,
+                         (long long)edgesRelaxed, (int)queuePeak, (long long)micros, (long long)bytes);
+        out.append(line, min(n, (int)sizeof(line) - 1));
+    }
+};
+
+AsyncLogger<SearchRecord> accessLog;
+
+// Run one validated search into `response`; returns the HTTP status
+int runSearch(const Network &net, int srcId, int destId, int maxStops, bool findMultiple, int k,
+              const SearchBudget &budget, json &response) {
+    const vector<string> &idToCity = net.idToCity;
+    int status;
+    if (findMultiple) {
+        bool truncated = false;
+        auto routes = net.graph.findMultipleRoutes(srcId, destId, maxStops, k, budget, &truncated);
+        
+        if (routes.empty()) {
+            response["error"] = "No routes found within " + to_string(maxStops) + " stops";
+            response["suggestion"] = "Try increasing maxStops limit";
+            status = 404;
+        } else {
+            json routeArray = json::array();
+            for (const auto& route : routes) {
+                json routeObj;
+                routeObj["fare"] = route.cost;
+                routeObj["stops"] = route.stops;
+                
+                vector<string> cityNames;
+                for (int id : route.path) {
+                    cityNames.push_back(idToCity[id]);
+                }
+                routeObj["route"] = cityNames;
+                routeArray.push_back(routeObj);
+            }
+            response["routes"] = routeArray;
+            response["totalRoutes"] = routes.size();
+            if (truncated) {
+                // Cheapest routes first, but fewer than k: the budget ran out
+                response["truncated"] = true;
+            }
+            status = 200;
+        }
+    } else {
+        auto result = net.fareTable.covers(maxStops)
+                          ? net.fareTable.route(srcId, destId, maxStops)
+                          : net.graph.shortest(srcId, destId, maxStops);
+        
+        if (result.first == -1) {
+            response["error"] = "No route found within " + to_string(maxStops) + " stops";
+            response["suggestion"] = "Try increasing maxStops limit";
+            status = 404;
+        } else {
+            response["fare"] = result.first;
+            response["stops"] = (int)result.second.size() - 1;
+            
+            vector<string> cityNames;
+            for (int id : result.second) {
+                cityNames.push_back(idToCity[id]);
+            }
+            response["route"] = cityNames;
+            status = 200;
+        }
+    }
+    return status;
+}
+
 void handleSearch(const httplib::Request &req, httplib::Response &res) {
     enableCORS(res);
     json response;
+    auto started = chrono::steady_clock::now();
+    SearchRecord record;
+    auto net = currentNetwork();
+    const vector<string> &idToCity = net->idToCity;
+    const CityMap &cityMap = net->cityMap;
+
+    // Request log line, plus the access log record when that is enabled
+    auto logSearch = [&](int status) {
+        logRequest("POST", "/search", status);
+        if (accessLog.started()) {
+            record.time = epochSeconds();
+            record.status = status;
+            record.micros = chrono::duration_cast<chrono::microseconds>(
+                                chrono::steady_clock::now() - started).count();
+            record.bytes = res.body.size();
+            accessLog.log(record);
+        }
+    };
 
     try {
         auto body = json::parse(req.body);
@@ -330,12 +2752,17 @@ void handleSearch(const httplib::Request &req, httplib::Response &res) {
             response["error"] = "Missing required fields: 'src' and 'dest'";
             res.set_content(response.dump(2), "application/json");
             res.status = 400;
-            logRequest("POST", "/search", 400);
+            logSearch(400);
             return;
         }
         
-        string src = toLowerCase(trim(body["src"]));
-        string dest = toLowerCase(trim(body["dest"]));
+        // Resolved once, straight from the parsed strings
+        string_view src = trimView(body["src"].get_ref<const string &>());
+        string_view dest = trimView(body["dest"].get_ref<const string &>());
+        int srcId = cityMap.find(src);
+        int destId = cityMap.find(dest);
+        record.src = srcId;
+        record.dest = destId;
         
         // Parse maxStops with default value
         int maxStops = DEFAULT_MAX_STOPS;
@@ -347,104 +2774,155 @@ void handleSearch(const httplib::Request &req, httplib::Response &res) {
                     response["error"] = "Invalid maxStops value";
                     res.set_content(response.dump(2), "application/json");
                     res.status = 400;
-                    logRequest("POST", "/search", 400);
+                    logSearch(400);
                     return;
                 }
             } else if (body["maxStops"].is_number()) {
-                maxStops = body["maxStops"];
+                maxStops = boundedInt(body["maxStops"], MAX_STOPS_LIMIT);
             }
         }
+        record.maxStops = maxStops;
         
         // Validate maxStops range
         if (maxStops < 0 || maxStops > MAX_STOPS_LIMIT) {
             response["error"] = "maxStops must be between 0 and " + to_string(MAX_STOPS_LIMIT);
             res.set_content(response.dump(2), "application/json");
             res.status = 400;
-            logRequest("POST", "/search", 400);
+            logSearch(400);
+            return;
+        }
+        
+        bool findMultiple = body.contains("multiple") && body["multiple"] == true;
+        record.multiple = findMultiple;
+
+        // Parse k (number of route options), which only multiple searches use
+        int k = DEFAULT_ROUTE_OPTIONS;
+        if (findMultiple && body.contains("k")) {
+            if (body["k"].is_string()) {
+                try {
+                    k = stoi(body["k"].get<string>());
+                } catch (...) {
+                    response["error"] = "Invalid k value";
+                    res.set_content(response.dump(2), "application/json");
+                    res.status = 400;
+                    logSearch(400);
+                    return;
+                }
+            } else if (body["k"].is_number()) {
+                k = boundedInt(body["k"], MAX_ROUTE_OPTIONS);
+            }
+        }
+        record.k = k;
+        
+        if (k < 1 || k > MAX_ROUTE_OPTIONS) {
+            response["error"] = "k must be between 1 and " + to_string(MAX_ROUTE_OPTIONS);
+            res.set_content(response.dump(2), "application/json");
+            res.status = 400;
+            logSearch(400);
             return;
         }
         
         // Check if same city
-        if (src == dest) {
+        if (srcId >= 0 ? srcId == destId : equalsIgnoreCase(src, dest)) {
             response["error"] = "Source and destination cannot be the same";
             res.set_content(response.dump(2), "application/json");
             res.status = 400;
-            logRequest("POST", "/search", 400);
+            logSearch(400);
             return;
         }
         
         // Validate city names
-        if (!cityMap.count(src)) {
+        if (srcId < 0) {
             response["error"] = "Invalid source city: " + body["src"].get<string>();
-            auto suggestions = suggestCities(src, idToCity);
+            auto suggestions = net->suggestions.suggest(string(src), idToCity);
             if (!suggestions.empty()) {
                 response["suggestions"] = suggestions;
             }
             res.set_content(response.dump(2), "application/json");
             res.status = 400;
-            logRequest("POST", "/search", 400);
+            logSearch(400);
             return;
         }
         
-        if (!cityMap.count(dest)) {
+        if (destId < 0) {
             response["error"] = "Invalid destination city: " + body["dest"].get<string>();
-            auto suggestions = suggestCities(dest, idToCity);
+            auto suggestions = net->suggestions.suggest(string(dest), idToCity);
             if (!suggestions.empty()) {
                 response["suggestions"] = suggestions;
             }
             res.set_content(response.dump(2), "application/json");
             res.status = 400;
-            logRequest("POST", "/search", 400);
+            logSearch(400);
             return;
         }
         
         // Find routes
-        bool findMultiple = body.contains("multiple") && body["multiple"] == true;
-        
-        if (findMultiple) {
-            auto routes = g.findMultipleRoutes(cityMap[src], cityMap[dest], maxStops, 3);
-            
-            if (routes.empty()) {
-                response["error"] = "No routes found within " + to_string(maxStops) + " stops";
-                response["suggestion"] = "Try increasing maxStops limit";
-                res.status = 404;
-            } else {
-                json routeArray = json::array();
-                for (const auto& route : routes) {
-                    json routeObj;
-                    routeObj["fare"] = route.cost;
-                    routeObj["stops"] = route.stops;
-                    
-                    vector<string> cityNames;
-                    for (int id : route.path) {
-                        cityNames.push_back(idToCity[id]);
+        uint64_t cacheKey = searchCacheKey(srcId, destId, maxStops, findMultiple, k);
+        SearchCache::Hit hit;
+        if (searchCache.enabled()) record.cache = 'm';
+        if (searchCache.enabled() && searchCache.get(cacheKey, net->generation, hit)) {
+            record.cache = 'h';
+            res.set_content(*hit.body, "application/json");
+            res.status = hit.status;
+            logSearch(res.status);
+            return;
+        }
+        // Search on the compute pool so a slow search holds a connection
+        // only until its deadline. The job outlives an abandoned request and
+        // still fills the cache for the retry.
+        struct SearchJob {
+            string content;
+            int status = 500;
+            SweepStats stats;
+            promise<void> done;
+        };
+        auto job = make_shared<SearchJob>();
+        auto finished = job->done.get_future();
+        auto now = chrono::steady_clock::now();
+        auto deadline = now + chrono::milliseconds(searchDeadlineMs);
+        SearchBudget budget;
+        budget.maxSpurSearches = maxSpurSearches;
+        budget.deadline = min(deadline, now + chrono::milliseconds(searchBudgetMs));
+        bool queued = computePool.submit(
+            [job, net, srcId, destId, maxStops, findMultiple, k, budget, cacheKey](bool expired) {
+                json result;
+                if (expired) {
+                    result["error"] = "Search deadline exceeded";
+                    job->status = 503;
+                } else {
+                    try {
+                        SweepStats &stats = shortestScratch().stats;
+                        stats = {};
+                        job->status = runSearch(*net, srcId, destId, maxStops, findMultiple, k, budget, result);
+                        job->stats = stats;
+                    } catch (const exception &e) {
+                        result = { {"error", "Internal server error"}, {"details", e.what()} };
+                        job->status = 500;
                     }
-                    routeObj["route"] = cityNames;
-                    routeArray.push_back(routeObj);
                 }
-                response["routes"] = routeArray;
-                response["totalRoutes"] = routes.size();
-                res.status = 200;
-            }
-        } else {
-            auto result = g.shortest(cityMap[src], cityMap[dest], maxStops);
-            
-            if (result.first == -1) {
-                response["error"] = "No route found within " + to_string(maxStops) + " stops";
-                response["suggestion"] = "Try increasing maxStops limit";
-                res.status = 404;
-            } else {
-                response["fare"] = result.first;
-                response["stops"] = (int)result.second.size() - 1;
-                
-                vector<string> cityNames;
-                for (int id : result.second) {
-                    cityNames.push_back(idToCity[id]);
+                job->content = result.dump(2);
+                if ((job->status == 200 || job->status == 404) && !result.contains("truncated")) {
+                    searchCache.put(cacheKey, net->generation, job->content, job->status);
                 }
-                response["route"] = cityNames;
-                res.status = 200;
-            }
+                job->done.set_value();
+            },
+            deadline);
+
+        if (!queued || finished.wait_until(deadline) != future_status::ready) {
+            response["error"] = queued ? "Search deadline exceeded" : "Server busy, retry shortly";
+            res.set_header("Retry-After", "1");
+            res.set_content(response.dump(2), "application/json");
+            res.status = 503;
+            logSearch(503);
+            return;
         }
+        res.set_content(job->content, "application/json");
+        res.status = job->status;
+        record.verticesExpanded = job->stats.verticesExpanded;
+        record.edgesRelaxed = job->stats.edgesRelaxed;
+        record.queuePeak = job->stats.frontierPeak;
+        logSearch(res.status);
+        return;
         
     } catch (const json::parse_error& e) {
         response["error"] = "Invalid JSON format";
@@ -461,7 +2939,212 @@ void handleSearch(const httplib::Request &req, httplib::Response &res) {
     }
 
     res.set_content(response.dump(2), "application/json");
-    logRequest("POST", "/search", res.status);
+    logSearch(res.status);
+}
+
+// One resolved query of a batch; src < 0 marks one rejected while parsing
+struct BatchQuery {
+    int src = -1;
+    int dest = -1;
+    int stops = 0;
+};
+
+// Answer a batch with one sweep per distinct source (or fare table walks
+// when the table covers the stops). Source groups are spread over the
+// cores; results come back in query order.
+vector<pair<int, vector<int>>> searchBatch(const Network &net, const vector<BatchQuery> &queries) {
+    vector<pair<int, vector<int>>> results(queries.size(), { -1, {} });
+    vector<int> order;
+    for (int i = 0; i < (int)queries.size(); i++) {
+        const BatchQuery &q = queries[i];
+        if (q.src < 0) continue;
+        if (net.fareTable.covers(q.stops)) {
+            results[i] = net.fareTable.route(q.src, q.dest, q.stops);
+        } else {
+            order.push_back(i);
+        }
+    }
+    stable_sort(order.begin(), order.end(),
+                [&](int a, int b) { return queries[a].src < queries[b].src; });
+
+    vector<size_t> groupStart;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i == 0 || queries[order[i]].src != queries[order[i - 1]].src) groupStart.push_back(i);
+    }
+    groupStart.push_back(order.size());
+    int groups = (int)groupStart.size() - 1;
+
+    parallelFor(groups, workerCount(), [&](int g, int) {
+        vector<pair<int, int>> targets;
+        for (size_t i = groupStart[g]; i < groupStart[g + 1]; i++) {
+            targets.push_back({ queries[order[i]].dest, queries[order[i]].stops });
+        }
+        auto answers = net.graph.shortestToMany(queries[order[groupStart[g]]].src, targets);
+        for (size_t i = groupStart[g]; i < groupStart[g + 1]; i++) {
+            results[order[i]] = move(answers[i - groupStart[g]]);
+        }
+    });
+    return results;
+}
+
+// The /search/batch response for resolved queries; errors[i] holds the
+// parse error of each rejected query
+json batchResponse(const Network &net, const vector<BatchQuery> &queries, vector<json> &errors) {
+    auto routes = searchBatch(net, queries);
+
+    json results = json::array();
+    int found = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        json result;
+        if (queries[i].src < 0) {
+            result = move(errors[i]);
+            result["status"] = 400;
+        } else if (routes[i].first == -1) {
+            result["error"] = "No route found within " + to_string(queries[i].stops) + " stops";
+            result["status"] = 404;
+        } else {
+            result["fare"] = routes[i].first;
+            result["stops"] = (int)routes[i].second.size() - 1;
+            vector<string> cityNames;
+            for (int id : routes[i].second) {
+                cityNames.push_back(net.idToCity[id]);
+            }
+            result["route"] = cityNames;
+            result["status"] = 200;
+            found++;
+        }
+        results.push_back(move(result));
+    }
+
+    json response;
+    response["results"] = move(results);
+    response["totalQueries"] = queries.size();
+    response["found"] = found;
+    return response;
+}
+
+// Parse, resolve and answer one /search/batch body into `response`; returns
+// the HTTP status. Rejected queries keep their error in place of a result.
+int runBatch(const Network &net, const string &body, json &response) {
+    json parsed;
+    try {
+        parsed = json::parse(body);
+    } catch (const json::parse_error &e) {
+        response["error"] = "Invalid JSON format";
+        response["details"] = e.what();
+        return 400;
+    }
+    const json &items = parsed.is_object() && parsed.contains("queries") ? parsed["queries"] : parsed;
+    if (!items.is_array()) {
+        response["error"] = "Expected an array of queries (or {\"queries\": [...]})";
+        return 400;
+    }
+    if (items.size() > (size_t)MAX_BATCH_QUERIES) {
+        response["error"] = "At most " + to_string(MAX_BATCH_QUERIES) + " queries per batch";
+        return 400;
+    }
+
+    vector<BatchQuery> queries(items.size());
+    vector<json> errors(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        const json &item = items[i];
+        BatchQuery &q = queries[i];
+        json &error = errors[i];
+        if (!item.is_object() || !item.contains("src") || !item.contains("dest") ||
+            !item["src"].is_string() || !item["dest"].is_string()) {
+            error["error"] = "Missing required fields: 'src' and 'dest'";
+            continue;
+        }
+
+        q.stops = DEFAULT_MAX_STOPS;
+        if (item.contains("maxStops")) {
+            const json &value = item["maxStops"];
+            if (value.is_number_integer()) {
+                q.stops = boundedInt(value, MAX_STOPS_LIMIT);
+            } else if (value.is_string()) {
+                const string &text = value.get_ref<const string &>();
+                auto [end, ec] = from_chars(text.data(), text.data() + text.size(), q.stops);
+                if (ec != errc() || end != text.data() + text.size()) q.stops = -1;
+            } else {
+                q.stops = -1;
+            }
+        }
+        if (q.stops < 0 || q.stops > MAX_STOPS_LIMIT) {
+            error["error"] = "maxStops must be between 0 and " + to_string(MAX_STOPS_LIMIT);
+            continue;
+        }
+
+        string_view src = trimView(item["src"].get_ref<const string &>());
+        string_view dest = trimView(item["dest"].get_ref<const string &>());
+        int srcId = net.cityMap.find(src);
+        int destId = net.cityMap.find(dest);
+        if (srcId >= 0 ? srcId == destId : equalsIgnoreCase(src, dest)) {
+            error["error"] = "Source and destination cannot be the same";
+        } else if (srcId < 0) {
+            error["error"] = "Invalid source city: " + item["src"].get<string>();
+            auto suggestions = net.suggestions.suggest(string(src), net.idToCity);
+            if (!suggestions.empty()) error["suggestions"] = suggestions;
+        } else if (destId < 0) {
+            error["error"] = "Invalid destination city: " + item["dest"].get<string>();
+            auto suggestions = net.suggestions.suggest(string(dest), net.idToCity);
+            if (!suggestions.empty()) error["suggestions"] = suggestions;
+        } else {
+            q.src = srcId;
+            q.dest = destId;
+        }
+    }
+
+    response = batchResponse(net, queries, errors);
+    return 200;
+}
+
+void handleSearchBatch(const httplib::Request &req, httplib::Response &res) {
+    enableCORS(res);
+    auto net = currentNetwork();
+
+    // Everything past reading the body, from parsing and resolving up to
+    // 10000 queries to the sweeps, runs on the compute pool like /search,
+    // under the same queue limit and deadline
+    struct BatchJob {
+        string body;
+        string content;
+        int status = 500;
+        promise<void> done;
+    };
+    auto job = make_shared<BatchJob>();
+    job->body = req.body;
+    auto finished = job->done.get_future();
+    auto deadline = chrono::steady_clock::now() + chrono::milliseconds(searchDeadlineMs);
+    bool queued = computePool.submit(
+        [job, net](bool expired) {
+            json result;
+            if (expired) {
+                result["error"] = "Search deadline exceeded";
+                job->status = 503;
+            } else {
+                try {
+                    job->status = runBatch(*net, job->body, result);
+                } catch (const exception &e) {
+                    result = { {"error", "Internal server error"}, {"details", e.what()} };
+                    job->status = 500;
+                }
+            }
+            job->content = result.dump(2);
+            job->done.set_value();
+        },
+        deadline);
+
+    if (!queued || finished.wait_until(deadline) != future_status::ready) {
+        json response;
+        response["error"] = queued ? "Search deadline exceeded" : "Server busy, retry shortly";
+        res.set_header("Retry-After", "1");
+        res.set_content(response.dump(2), "application/json");
+        res.status = 503;
+    } else {
+        res.set_content(job->content, "application/json");
+        res.status = job->status;
+    }
+    logRequest("POST", "/search/batch", res.status);
 }
 
 void handleHealth(const httplib::Request &req, httplib::Response &res) {
@@ -471,6 +3154,14 @@ void handleHealth(const httplib::Request &req, httplib::Response &res) {
     response["status"] = "healthy";
     response["timestamp"] = getCurrentTimestamp();
     response["version"] = "2.0";
+    auto net = currentNetwork();
+    response["network"] = {
+        {"cities", net->idToCity.size()},
+        {"legs", net->graph.edgeCount()},
+        {"generation", net->generation}
+    };
+    response["cache"] = searchCache.stats();
+    response["compute"] = computePool.stats();
     
     res.set_content(response.dump(2), "application/json");
     res.status = 200;
@@ -478,16 +3169,181 @@ void handleHealth(const httplib::Request &req, httplib::Response &res) {
     logRequest("GET", "/health", 200);
 }
 
+// Prometheus text format: request metrics plus network, cache and compute
+// pool state
+void handleMetrics(const httplib::Request &req, httplib::Response &res) {
+    string out;
+    requestMetrics.write(out);
+
+    auto metric = [&out](const char *name, const char *type, const char *help, double value) {
+        out += string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n" +
+               name + " " + to_string((long long)value) + "\n";
+    };
+    auto net = currentNetwork();
+    metric("flightfare_network_cities", "gauge", "Cities in the current network.", net->idToCity.size());
+    metric("flightfare_network_legs", "gauge", "Directed legs in the current network.", net->graph.edgeCount());
+    metric("flightfare_network_generation", "gauge", "Reloads published since startup.", net->generation);
+
+    json cache = searchCache.stats();
+    metric("flightfare_cache_hits_total", "counter", "Search cache hits.", cache["hits"]);
+    metric("flightfare_cache_misses_total", "counter", "Search cache misses.", cache["misses"]);
+    metric("flightfare_cache_entries", "gauge", "Cached search responses.", cache["entries"]);
+
+    json compute = computePool.stats();
+    metric("flightfare_compute_queued", "gauge", "Searches waiting for a compute thread.", compute["queued"]);
+    metric("flightfare_compute_running", "gauge", "Searches running on compute threads.", compute["running"]);
+    metric("flightfare_compute_rejected_total", "counter", "Searches refused with a full queue.", compute["rejected"]);
+    metric("flightfare_compute_expired_total", "counter", "Searches dropped at their deadline.", compute["expired"]);
+
+    res.set_content(out, "text/plain; version=0.0.4");
+    res.status = 200;
+    logRequest("GET", "/metrics", 200);
+}
+
+// A reload rebuilds the whole network (with --precompute, an all-cores
+// all-pairs sweep), so it is never offered to browsers: no CORS headers, and
+// requests carrying an Origin are refused. Other clients need the token when
+// one is configured, and must connect over loopback otherwise. Returns why
+// the request is refused, or nullptr.
+const char *reloadRefusal(const httplib::Request &req) {
+    if (req.has_header("Origin")) return "Reload is not available to browsers";
+    if (!reloadToken.empty()) {
+        string given = req.get_header_value("X-Reload-Token");
+        unsigned char diff = given.size() != reloadToken.size();
+        for (size_t i = 0; i < given.size() && i < reloadToken.size(); i++) {
+            diff |= given[i] ^ reloadToken[i];
+        }
+        return diff == 0 ? nullptr : "Reload needs a valid X-Reload-Token header";
+    }
+    const string &addr = req.remote_addr;
+    bool loopback = addr == "::1" || addr.rfind("127.", 0) == 0 || addr.rfind("::ffff:127.", 0) == 0;
+    return loopback ? nullptr : "Reload is only accepted from localhost";
+}
+
+void handleReload(const httplib::Request &req, httplib::Response &res) {
+    json response;
+    if (const char *refusal = reloadRefusal(req)) {
+        response["error"] = refusal;
+        res.status = 403;
+        res.set_content(response.dump(2), "application/json");
+        logRequest("POST", "/reload", res.status);
+        return;
+    }
+
+    // Build the replacement off to the side; searches keep using the old one
+    unique_lock<mutex> lock(reloadMutex, try_to_lock);
+    if (!lock.owns_lock()) {
+        response["error"] = "A reload is already in progress";
+        res.status = 409;
+    } else {
+        try {
+            auto start = chrono::steady_clock::now();
+            auto next = loadNetwork(networkSource);
+            publishNetwork(next);
+            auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+            response["status"] = "reloaded";
+            response["cities"] = next->idToCity.size();
+            response["legs"] = next->graph.edgeCount();
+            response["generation"] = next->generation;
+            response["durationMs"] = ms;
+            res.status = 200;
+        } catch (const exception &e) {
+            response["error"] = "Reload failed, keeping the current network";
+            response["details"] = e.what();
+            res.status = 500;
+        }
+    }
+
+    res.set_content(response.dump(2), "application/json");
+    logRequest("POST", "/reload", res.status);
+}
+
 // ------------------------ Web Server ------------------------
 
-int main() {
+// Tools such as bench.cpp include this file with FLIGHTFARE_NO_MAIN defined.
+#ifndef FLIGHTFARE_NO_MAIN
+int main(int argc, char *argv[]) {
+    int cacheEntries = DEFAULT_CACHE_ENTRIES;
+    int computeThreads = workerCount();
+    int computeQueue = DEFAULT_COMPUTE_QUEUE;
+    string writeSnapshotFile;
+    string accessLogFile;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--precompute" && i + 1 < argc) {
+            networkSource.precomputeStops = min(max(atoi(argv[++i]), 0), MAX_STOPS_LIMIT);
+        } else if (arg == "--data" && i + 1 < argc) {
+            networkSource.dataFile = argv[++i];
+        } else if (arg == "--aliases" && i + 1 < argc) {
+            networkSource.aliasesFile = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            networkSource.snapshotFile = argv[++i];
+        } else if (arg == "--write-snapshot" && i + 1 < argc) {
+            writeSnapshotFile = argv[++i];
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cacheEntries = max(atoi(argv[++i]), 0);
+        } else if (arg == "--compute-threads" && i + 1 < argc) {
+            computeThreads = max(atoi(argv[++i]), 1);
+        } else if (arg == "--compute-queue" && i + 1 < argc) {
+            computeQueue = max(atoi(argv[++i]), 0);
+        } else if (arg == "--deadline-ms" && i + 1 < argc) {
+            searchDeadlineMs = max(atoi(argv[++i]), 1);
+        } else if (arg == "--search-budget-ms" && i + 1 < argc) {
+            searchBudgetMs = max(atoi(argv[++i]), 1);
+        } else if (arg == "--access-log" && i + 1 < argc) {
+            accessLogFile = argv[++i];
+        } else if (arg == "--max-spur-searches" && i + 1 < argc) {
+            maxSpurSearches = max(atoll(argv[++i]), 0LL);
+        } else if (arg == "--reload-token" && i + 1 < argc) {
+            reloadToken = argv[++i];
+        }
+    }
+    searchCache.setCapacity(cacheEntries);
+
     cout << "\n================================" << endl;
     cout << "  Flight Route Finder API v2.0  " << endl;
     cout << "================================\n" << endl;
     
-    initData();
+    try {
+        if (!writeSnapshotFile.empty()) {
+            networkSource.precomputeStops = -1;
+            writeSnapshot(*loadNetwork(networkSource), writeSnapshotFile);
+            return 0;
+        }
+        publishNetwork(loadNetwork(networkSource));
+    } catch (const exception &e) {
+        cerr << "✗ " << e.what() << endl;
+        return 1;
+    }
+    computePool.start(computeThreads, computeQueue);
+
+    if (!accessLogFile.empty()) {
+        FILE *file = accessLogFile == "-" ? stdout : fopen(accessLogFile.c_str(), "a");
+        if (!file) {
+            cerr << "✗ cannot open " << accessLogFile << endl;
+            return 1;
+        }
+        accessLog.start(file);
+    }
     
     httplib::Server svr;
+    // Headers and body go out in separate writes; without this, Nagle's
+    // algorithm holds the body for the client's delayed ACK (~40 ms) on
+    // every keep-alive request
+    svr.set_tcp_nodelay(true);
+
+    // Time every request from routing until its response is written; a
+    // connection is served start to finish on one thread
+    static thread_local chrono::steady_clock::time_point requestStart;
+    svr.set_pre_routing_handler([](const httplib::Request &, httplib::Response &) {
+        requestStart = chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+    svr.set_logger([](const httplib::Request &req, const httplib::Response &res) {
+        auto nanos = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - requestStart);
+        requestMetrics.record(RequestMetrics::endpointOf(req.path), res.status, nanos.count());
+    });
 
     // OPTIONS handler for CORS preflight
     svr.Options(".*", [](const httplib::Request &req, httplib::Response &res) { 
@@ -497,8 +3353,13 @@ int main() {
 
     // API Routes
     svr.Get("/cities", handleGetCities);
+    svr.Get("/autocomplete", handleAutocomplete);
     svr.Post("/search", handleSearch);
+    svr.Post("/search/batch", handleSearchBatch);
+    svr.Get(R"(/from/([^/]+))", handleFaresFrom);
+    svr.Get("/metrics", handleMetrics);
     svr.Get("/health", handleHealth);
+    svr.Post("/reload", handleReload);
     
     // Root endpoint
     svr.Get("/", [](const httplib::Request &req, httplib::Response &res) {
@@ -508,8 +3369,13 @@ int main() {
         response["version"] = "2.0";
         response["endpoints"] = {
             {"GET /cities", "List all available cities"},
-            {"POST /search", "Find cheapest route (body: {src, dest, maxStops?, multiple?})"},
-            {"GET /health", "Check API health status"}
+            {"GET /autocomplete", "Cities starting with a prefix, busiest first (query: q, limit?)"},
+            {"POST /search", "Find cheapest route (body: {src, dest, maxStops?, multiple?, k?})"},
+            {"POST /search/batch", "Cheapest routes for many queries (body: [{src, dest, maxStops?}, ...])"},
+            {"GET /from/{city}", "Cheapest fare to every reachable city (query: maxStops?)"},
+            {"GET /health", "Check API health status"},
+            {"GET /metrics", "Request counts and latency histograms (Prometheus text format)"},
+            {"POST /reload", "Rebuild the route network from its source and swap it in"}
         };
         res.set_content(response.dump(2), "application/json");
         res.status = 200;
@@ -519,11 +3385,18 @@ int main() {
     cout << "\n🚀 Server running at: http://localhost:8080" << endl;
     cout << "📍 Endpoints:" << endl;
     cout << "   GET  /cities  - List all cities" << endl;
+    cout << "   GET  /autocomplete?q= - City name completions" << endl;
     cout << "   POST /search  - Find routes" << endl;
+    cout << "   POST /search/batch - Cheapest routes for many queries" << endl;
+    cout << "   GET  /from/{city} - Cheapest fares to every city" << endl;
     cout << "   GET  /health  - Health check" << endl;
+    cout << "   GET  /metrics - Prometheus metrics" << endl;
+    cout << "   POST /reload  - Reload route network" << endl;
     cout << "\n⏳ Waiting for requests...\n" << endl;
     
+    requestLog.start();
     svr.listen("0.0.0.0", 8080);
     
     return 0;
-}
\ No newline at end of file
+}
+#endif
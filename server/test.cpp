@@ -0,0 +1,934 @@
+// Tests for the route engine, the city indexes and the server plumbing. Fast
+// paths are checked against brute force or the simpler implementation they
+// replaced, on seeded random graphs and name sets.
+//
+// Build (from server/):
+//   g++ -std=c++17 -O2 test.cpp -o test -pthread
+//   ./test
+// On Windows (MinGW-w64) add -lws2_32 as for server.cpp. Exits with 1 when
+// any check fails.
+
+#define FLIGHTFARE_NO_MAIN
+#include "server.cpp"
+
+#include <filesystem>
+#include <map>
+#include <random>
+
+// ------------------------ Harness ------------------------
+
+static long long checkCount = 0, failureCount = 0;
+
+// Count a check; the first few failures of a test are printed
+void check(bool ok, const string &what) {
+    checkCount++;
+    if (ok) return;
+    if (failureCount++ < 5) cout << "    failed: " << what << endl;
+}
+
+template <typename Fn>
+void runTest(const string &name, Fn test) {
+    long long checksBefore = checkCount, failuresBefore = failureCount;
+    test();
+    long long checks = checkCount - checksBefore, failures = failureCount - failuresBefore;
+    if (failures == 0) {
+        cout << "✓ " << name << " (" << checks << " checks)" << endl;
+    } else {
+        cout << "✗ " << name << ": " << failures << " of " << checks << " checks failed" << endl;
+    }
+}
+
+// Discards cout while alive, for loaders that report what they loaded
+struct QuietCout {
+    ostringstream sink;
+    streambuf *saved = cout.rdbuf(sink.rdbuf());
+    ~QuietCout() { cout.rdbuf(saved); }
+};
+
+// A path in the temp directory, removed when the test ends
+struct TempFile {
+    string path;
+    explicit TempFile(const string &name) : path((filesystem::temp_directory_path() / name).string()) {}
+    ~TempFile() { remove(path.c_str()); }
+};
+
+string describe(int src, int dest, int maxStops) {
+    return to_string(src) + " -> " + to_string(dest) + " within " + to_string(maxStops) + " stops";
+}
+
+// ------------------------ Generators ------------------------
+
+// Random network with parallel legs and small fares, so ties are common
+Graph randomGraph(int cities, int legs, int maxFare, mt19937 &rng) {
+    Graph g(cities);
+    for (int i = 0; i < legs; i++) {
+        int u = rng() % cities, v = rng() % cities;
+        if (u != v) g.addEdge(u, v, 1 + rng() % maxFare);
+    }
+    g.freeze();
+    return g;
+}
+
+// Random network where half the legs touch one of a few hubs, so that a
+// frontier of a handful of cities can carry a good part of the legs
+Graph hubGraph(int cities, int legs, int hubs, mt19937 &rng) {
+    Graph g(cities);
+    for (int i = 0; i < legs; i++) {
+        int u = rng() % cities, v = rng() % cities;
+        if (i % 2) u = rng() % hubs;
+        if (u != v) g.addEdge(u, v, 1 + rng() % 9000);
+    }
+    g.freeze();
+    return g;
+}
+
+// Capitalized pseudo-words of 1-14 letters over a small alphabet, so that
+// names collide within a few edits
+vector<string> randomNames(int count, mt19937 &rng) {
+    vector<string> names;
+    for (int i = 0; i < count; i++) {
+        string name;
+        for (int n = 1 + rng() % 14; n > 0; n--) name += char('a' + rng() % 8);
+        name[0] = toupper(name[0]);
+        names.push_back(name);
+    }
+    return names;
+}
+
+// Copies of random names with up to three random single-letter edits
+vector<string> randomTypos(const vector<string> &names, int count, mt19937 &rng) {
+    vector<string> typos;
+    for (int i = 0; i < count; i++) {
+        string s = names[rng() % names.size()];
+        for (int e = rng() % 4; e > 0; e--) {
+            size_t at = rng() % (s.size() + 1);
+            switch (rng() % 3) {
+                case 0: if (at < s.size()) s[at] = char('a' + rng() % 8); break;
+                case 1: s.insert(s.begin() + at, char('a' + rng() % 8)); break;
+                default: if (at < s.size()) s.erase(at, 1);
+            }
+        }
+        typos.push_back(s);
+    }
+    return typos;
+}
+
+// ------------------------ References ------------------------
+
+// Cheapest leg from u to v, INF when there is none
+int legFare(const Graph &g, int u, int v) {
+    int best = INF;
+    for (int e = g.offsets[u]; e < g.offsets[u + 1]; e++) {
+        if (g.edgeTo[e] == v) best = min(best, g.edgeCost[e]);
+    }
+    return best;
+}
+
+// Every loopless route from src to dest within maxStops (at most maxStops + 1
+// legs), each taking the cheapest leg between consecutive cities, by cost
+vector<pair<int, vector<int>>> allRoutes(const Graph &g, int src, int dest, int maxStops) {
+    vector<pair<int, vector<int>>> routes;
+    vector<int> path{ src };
+    function<void(int, int)> extend = [&](int u, int cost) {
+        if (u == dest) {
+            routes.push_back({ cost, path });
+            return;
+        }
+        if ((int)path.size() > maxStops + 1) return;
+        for (int v = 0; v < g.V; v++) {
+            int fare = legFare(g, u, v);
+            if (fare >= INF || find(path.begin(), path.end(), v) != path.end()) continue;
+            path.push_back(v);
+            extend(v, cost + fare);
+            path.pop_back();
+        }
+    };
+    extend(src, 0);
+    sort(routes.begin(), routes.end());
+    return routes;
+}
+
+// Stop-limited Bellman-Ford relaxing every reached city in every round,
+// skipping flagged cities and legs; returns the fare, -1 when unreachable
+int scanFare(const Graph &g, int src, int dest, int maxStops,
+             const vector<char> &blockedCity, const vector<char> &blockedEdge) {
+    vector<int> dist(g.V, INF);
+    dist[src] = 0;
+    for (int k = 0; k <= maxStops; k++) {
+        vector<int> next = dist;
+        for (int u = 0; u < g.V; u++) {
+            if (dist[u] >= INF) continue;
+            for (int e = g.offsets[u]; e < g.offsets[u + 1]; e++) {
+                int v = g.edgeTo[e];
+                if (blockedEdge[e] || blockedCity[v]) continue;
+                next[v] = min(next[v], dist[u] + g.edgeCost[e]);
+            }
+        }
+        dist = next;
+    }
+    return dist[dest] >= INF ? -1 : dist[dest];
+}
+
+// Cost of a route over its cheapest legs, -1 when a leg is missing
+int routeCost(const Graph &g, const vector<int> &path) {
+    int cost = 0;
+    for (size_t i = 0; i + 1 < path.size(); i++) {
+        int fare = legFare(g, path[i], path[i + 1]);
+        if (fare >= INF) return -1;
+        cost += fare;
+    }
+    return cost;
+}
+
+// Textbook O(n * m) edit distance
+int matrixLevenshtein(const string &a, const string &b) {
+    int n = a.size(), m = b.size();
+    vector<vector<int>> dp(n + 1, vector<int>(m + 1));
+    for (int i = 0; i <= n; i++) dp[i][0] = i;
+    for (int j = 0; j <= m; j++) dp[0][j] = j;
+    for (int i = 1; i <= n; i++) {
+        for (int j = 1; j <= m; j++) {
+            dp[i][j] = a[i - 1] == b[j - 1] ? dp[i - 1][j - 1]
+                                             : 1 + min({ dp[i - 1][j], dp[i][j - 1], dp[i - 1][j - 1] });
+        }
+    }
+    return dp[n][m];
+}
+
+// Best MAX_AUTOCOMPLETE cities starting with prefix: most legs first, then
+// by name, one city per lowercased name (the lowest id)
+vector<string> scanCompletions(const string &prefix, const vector<string> &cities, const Graph &g) {
+    map<string, int> firstId;
+    for (int c = 0; c < (int)cities.size(); c++) firstId.emplace(toLowerCase(cities[c]), c);
+
+    string lower = toLowerCase(prefix);
+    vector<int> ids;
+    for (const auto &[name, c] : firstId) {
+        if (name.compare(0, lower.size(), lower) == 0) ids.push_back(c);
+    }
+    auto degree = [&](int c) { return g.offsets[c + 1] - g.offsets[c]; };
+    sort(ids.begin(), ids.end(), [&](int a, int b) {
+        return degree(a) != degree(b) ? degree(a) > degree(b) : cities[a] < cities[b];
+    });
+    vector<string> result;
+    for (int i = 0; i < min(MAX_AUTOCOMPLETE, (int)ids.size()); i++) result.push_back(cities[ids[i]]);
+    return result;
+}
+
+// Up to three cities within three edits of a name, or of an alias within
+// the alias limits (codes of up to three letters only when equal, longer
+// aliases within a third of the shorter string), by (distance, matched by
+// name first, name)
+vector<string> scanSuggestions(const string &wrong, const vector<string> &cities,
+                               const vector<pair<string, int>> &aliases) {
+    string lower = toLowerCase(wrong);
+    vector<pair<int, bool>> best(cities.size(), { INF, false });
+    for (size_t c = 0; c < cities.size(); c++) best[c] = { matrixLevenshtein(lower, toLowerCase(cities[c])), false };
+    for (const auto &[alias, c] : aliases) {
+        string term = toLowerCase(alias);
+        int allowed = term.size() <= 3 ? 0 : (int)min(term.size(), lower.size()) / 3;
+        int dist = matrixLevenshtein(lower, term);
+        if (dist <= allowed) best[c] = min(best[c], { dist, true });
+    }
+
+    vector<tuple<int, bool, string>> scores;
+    for (size_t c = 0; c < cities.size(); c++) {
+        if (best[c].first <= 3) scores.push_back({ best[c].first, best[c].second, cities[c] });
+    }
+    sort(scores.begin(), scores.end());
+    vector<string> result;
+    for (int i = 0; i < min(3, (int)scores.size()); i++) result.push_back(get<2>(scores[i]));
+    return result;
+}
+
+// ------------------------ Route Tests ------------------------
+
+void testShortestBruteForce() {
+    mt19937 rng(1);
+    for (int round = 0; round < 40; round++) {
+        int cities = 4 + rng() % 7;
+        Graph g = randomGraph(cities, cities * (1 + rng() % 4), 30, rng);
+        for (int src = 0; src < cities; src++) {
+            for (int dest = 0; dest < cities; dest++) {
+                for (int maxStops = 0; maxStops <= 4; maxStops++) {
+                    auto [fare, path] = g.shortest(src, dest, maxStops);
+                    string what = describe(src, dest, maxStops);
+                    if (src == dest) {
+                        check(fare == 0 && path == vector<int>{ src }, what);
+                        continue;
+                    }
+                    auto routes = allRoutes(g, src, dest, maxStops);
+                    check(fare == (routes.empty() ? -1 : routes[0].first), what + ": fare");
+                    if (fare == -1) {
+                        check(path.empty(), what + ": path without a fare");
+                    } else {
+                        check(path.front() == src && path.back() == dest &&
+                              (int)path.size() <= maxStops + 2 && routeCost(g, path) == fare,
+                              what + ": path");
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Larger uniform and hub networks, so that sweeps mix sparse rounds with
+// dense ones, with and without blocked cities and legs
+void testShortestFullScan() {
+    mt19937 rng(10);
+    for (int round = 0; round < 12; round++) {
+        int cities = 500 + rng() % 1500;
+        Graph g = round % 2 ? hubGraph(cities, cities * 8, 5, rng) : randomGraph(cities, cities * (1 + round), 9000, rng);
+        vector<char> noCities(g.V, 0), noLegs(g.edgeCount(), 0);
+        vector<char> blockedCity(g.V), blockedEdge(g.edgeCount());
+        for (auto &b : blockedCity) b = rng() % 10 == 0;
+        for (auto &b : blockedEdge) b = rng() % 5 == 0;
+
+        for (int q = 0; q < 100; q++) {
+            int src = rng() % cities, dest = rng() % cities, maxStops = rng() % 8;
+            if (src == dest) continue;
+            string what = describe(src, dest, maxStops);
+
+            auto [fare, path] = g.shortest(src, dest, maxStops);
+            check(fare == scanFare(g, src, dest, maxStops, noCities, noLegs), what + ": fare");
+            if (fare != -1) {
+                check(path.front() == src && path.back() == dest &&
+                      (int)path.size() <= maxStops + 2 && routeCost(g, path) == fare,
+                      what + ": path");
+            }
+
+            blockedCity[src] = 0;
+            auto blocked = g.shortest(src, dest, maxStops, blockedCity.data(), blockedEdge.data());
+            check(blocked.first == scanFare(g, src, dest, maxStops, blockedCity, blockedEdge),
+                  what + ": fare with blocked cities and legs");
+            for (size_t i = 1; i < blocked.second.size(); i++) {
+                check(!blockedCity[blocked.second[i]], what + ": path through a blocked city");
+            }
+        }
+    }
+}
+
+void testMultipleRoutes() {
+    mt19937 rng(2);
+    for (int round = 0; round < 60; round++) {
+        int cities = 5 + rng() % 6;
+        Graph g = randomGraph(cities, cities * (2 + rng() % 3), 30, rng);
+        for (int q = 0; q < 30; q++) {
+            int src = rng() % cities, dest = rng() % cities, maxStops = rng() % 5, k = 1 + rng() % 8;
+            if (src == dest) continue;
+            string what = describe(src, dest, maxStops) + ", k " + to_string(k);
+
+            // Yen returns the k cheapest loopless routes of at most maxStops
+            // legs; among equal costs any may come first, so the costs are
+            // compared in order
+            auto expected = maxStops < 1 ? vector<pair<int, vector<int>>>{} : allRoutes(g, src, dest, maxStops - 1);
+            auto routes = g.findMultipleRoutes(src, dest, maxStops, k);
+            check(routes.size() == min((size_t)k, expected.size()), what + ": count");
+
+            set<vector<int>> seen;
+            for (size_t i = 0; i < routes.size() && i < expected.size(); i++) {
+                const Route &r = routes[i];
+                set<int> distinct(r.path.begin(), r.path.end());
+                check(r.cost == expected[i].first, what + ": cost of route " + to_string(i));
+                check(routeCost(g, r.path) == r.cost && r.stops == (int)r.path.size() - 1 &&
+                      r.stops <= maxStops && distinct.size() == r.path.size() &&
+                      r.path.front() == src && r.path.back() == dest && seen.insert(r.path).second,
+                      what + ": route " + to_string(i));
+            }
+        }
+    }
+}
+
+void testShortestToMany() {
+    mt19937 rng(3);
+    Graph g = randomGraph(400, 2400, 9000, rng);
+    for (int q = 0; q < 100; q++) {
+        int src = rng() % g.V;
+        vector<pair<int, int>> targets;
+        for (int i = 0; i < 50; i++) targets.push_back({ (int)(rng() % g.V), (int)(rng() % 8) });
+        targets.push_back({ src, 3 });
+        auto answers = g.shortestToMany(src, targets);
+        for (size_t i = 0; i < targets.size(); i++) {
+            check(answers[i] == g.shortest(src, targets[i].first, targets[i].second),
+                  describe(src, targets[i].first, targets[i].second));
+        }
+    }
+
+    Network net;
+    net.graph = randomGraph(300, 1500, 30, rng);
+    vector<BatchQuery> queries(3000);
+    for (int i = 0; i < (int)queries.size(); i++) {
+        if (i % 40 == 0) continue;  // rejected while parsing
+        queries[i] = { (int)(rng() % 300), (int)(rng() % 300), (int)(rng() % 6) };
+    }
+    auto results = searchBatch(net, queries);
+    for (size_t i = 0; i < queries.size(); i++) {
+        const BatchQuery &q = queries[i];
+        if (q.src < 0) {
+            check(results[i].first == -1, "rejected batch query " + to_string(i));
+        } else {
+            check(results[i] == net.graph.shortest(q.src, q.dest, q.stops),
+                  "batch query " + to_string(i) + ": " + describe(q.src, q.dest, q.stops));
+        }
+    }
+}
+
+void testFaresFrom() {
+    mt19937 rng(5);
+    for (int round = 0; round < 6; round++) {
+        Graph g = randomGraph(200, 200 * (1 + round), round % 2 ? 30 : 9000, rng);
+        for (int q = 0; q < 20; q++) {
+            int src = rng() % g.V, maxStops = rng() % 6;
+            auto fares = g.faresFrom(src, maxStops);
+            vector<char> listed(g.V, 0);
+            for (size_t i = 0; i < fares.size(); i++) {
+                auto [city, fare, legs, prev] = fares[i];
+                listed[city] = 1;
+                auto [expected, path] = g.shortest(src, city, maxStops);
+                string what = describe(src, city, maxStops);
+                check(fare == expected, what + ": fare");
+                check(legs == (int)path.size() - 1 && path.size() >= 2 && prev == path[path.size() - 2],
+                      what + ": legs and previous city");
+                check(i == 0 || get<1>(fares[i - 1]) <= fare, what + ": order");
+            }
+            for (int dest = 0; dest < g.V; dest++) {
+                if (!listed[dest] && dest != src) {
+                    check(g.shortest(src, dest, maxStops).first == -1, describe(src, dest, maxStops) + ": missing");
+                }
+            }
+        }
+    }
+}
+
+// ------------------------ Fare Table Tests ------------------------
+
+void testFareTable() {
+    mt19937 rng(4);
+    for (int round = 0; round < 4; round++) {
+        Graph g = randomGraph(150, 150 * (1 + round * 2), round % 2 ? 30 : 9000, rng);
+        FareTable table;
+        table.build(g, 5, 1 + round);  // 1 to 4 workers
+        check(table.covers(5) && !table.covers(6), "covers");
+        for (int src = 0; src < g.V; src += 3) {
+            for (int dest = 0; dest < g.V; dest++) {
+                int maxStops = rng() % 6;
+                check(table.route(src, dest, maxStops) == g.shortest(src, dest, maxStops),
+                      describe(src, dest, maxStops));
+            }
+        }
+    }
+}
+
+void testParallelFor() {
+    mt19937 rng(11);
+    for (int round = 0; round < 200; round++) {
+        int count = round < 20 ? round : (int)(rng() % 5000);
+        int workers = 1 + rng() % 12;
+        vector<atomic<int>> runs(count);
+        atomic<bool> badWorker{false};
+        parallelFor(count, workers, [&](int i, int worker) {
+            if (worker < 0 || worker >= workers) {
+                badWorker = true;
+                return;
+            }
+            runs[i]++;
+        });
+        string what = to_string(count) + " items on " + to_string(workers) + " workers";
+        check(!badWorker, what + ": worker index");
+        int wrong = 0;
+        for (int i = 0; i < count; i++) wrong += runs[i] != 1;
+        check(wrong == 0, what + ": " + to_string(wrong) + " items not run exactly once");
+    }
+}
+
+// ------------------------ City Tests ------------------------
+
+void testLevenshtein() {
+    mt19937 rng(6);
+    auto names = randomNames(2000, rng);
+    auto typos = randomTypos(names, 20000, rng);
+    typos.push_back("");
+    typos.push_back(string(100, 'a'));  // past the 64-character bit-parallel limit
+    for (size_t i = 0; i < typos.size(); i++) {
+        const string &a = typos[i], &b = names[rng() % names.size()];
+        string lowerA = toLowerCase(a), lowerB = toLowerCase(b);
+        int expected = matrixLevenshtein(lowerA, lowerB);
+        check(levenshtein(lowerA, lowerB) == expected, "levenshtein(" + a + ", " + b + ")");
+        int maxDist = rng() % 5;
+        check(EditDistancePattern(lowerA).distance(b, maxDist) == min(expected, maxDist + 1),
+              "bounded distance(" + a + ", " + b + ")");
+    }
+}
+
+void testSuggestions() {
+    mt19937 rng(7);
+    auto names = randomNames(3000, rng);
+    for (int i = 0; i < 100; i++) names.push_back(string(30 + rng() % 50, 'a' + rng() % 3));
+    auto typos = randomTypos(names, 4000, rng);
+    typos.push_back("");
+    typos.push_back("a");
+
+    SuggestionIndex index;
+    index.build(names, {});
+    for (const auto &typo : typos) {
+        check(index.suggest(typo, names) == suggestCities(typo, names), "suggest(" + typo + ")");
+    }
+}
+
+void testAutocomplete() {
+    mt19937 rng(8);
+    // Small sets whose names all share a prefix, a single city, and a large
+    // random set with duplicates differing only in case
+    vector<vector<string>> nameSets = {
+        { "San Jose", "San Diego", "Santa Fe" },
+        { "Paris" },
+        { "Ab", "AB", "Abc", "A" },
+    };
+    auto many = randomNames(5000, rng);
+    for (int i = 0; i < 50; i++) many.push_back(toLowerCase(many[rng() % 5000]));
+    nameSets.push_back(many);
+
+    for (const auto &names : nameSets) {
+        Graph g = randomGraph(names.size(), names.size() * 4, 30, rng);
+        AutocompleteIndex index;
+        index.build(names, g);
+
+        vector<string> prefixes = { "", "q", "S", "san", "SAN ", "sant", "pa", "paris", "parisx" };
+        for (int i = 0; i < 500; i++) {
+            const string &name = names[rng() % names.size()];
+            prefixes.push_back(name.substr(0, rng() % (name.size() + 1)) + (i % 9 == 0 ? "x" : ""));
+        }
+        for (const auto &prefix : prefixes) {
+            check(index.complete(prefix, MAX_AUTOCOMPLETE) == scanCompletions(prefix, names, g),
+                  "complete(" + prefix + ") over " + to_string(names.size()) + " names");
+        }
+    }
+}
+
+void testAliasSuggestions() {
+    mt19937 rng(11);
+    auto names = randomNames(3000, rng);
+    vector<pair<string, int>> aliases;
+    for (int i = 0; i < 1500; i++) {
+        string alias;
+        for (int n = 2 + rng() % 8; n > 0; n--) alias += char('A' + rng() % 26);
+        aliases.push_back({ alias, (int)(rng() % names.size()) });
+    }
+    auto typos = randomTypos(names, 3000, rng);
+    for (int i = 0; i < 2000; i++) {
+        typos.push_back(randomTypos({ aliases[rng() % aliases.size()].first }, 1, rng)[0]);
+    }
+    SuggestionIndex index;
+    index.build(names, aliases);
+    for (const auto &typo : typos) {
+        check(index.suggest(typo, names) == scanSuggestions(typo, names, aliases), "suggest(" + typo + ")");
+    }
+
+    // Short inputs near IATA codes get the suggestions of the names alone,
+    // while a misspelled former name still finds its city
+    shared_ptr<Network> net;
+    {
+        QuietCout quiet;
+        net = loadNetwork({});
+    }
+    const auto &cities = net->idToCity;
+    check(net->suggestions.suggest("Gao", cities) == vector<string>{ "Goa" }, "suggest(Gao)");
+    for (string typo : { "NYC", "x", "Pue", "dl", "BMO" }) {
+        check(net->suggestions.suggest(typo, cities) == suggestCities(typo, cities), "built-in suggest(" + typo + ")");
+    }
+    check(net->suggestions.suggest("Bombya", cities) == vector<string>{ "Mumbai" }, "suggest(Bombya)");
+    check(net->suggestions.suggest("Calcuta", cities) == vector<string>{ "Kolkata" }, "suggest(Calcuta)");
+}
+
+void testCityMap() {
+    mt19937 rng(9);
+    auto names = randomNames(5000, rng);
+    CityMap cityMap;
+    map<string, int> expected;
+    for (int i = 0; i < (int)names.size(); i++) {
+        bool fresh = expected.emplace(toLowerCase(names[i]), i).second;
+        check(cityMap.insert(names[i], i) == fresh, "insert(" + names[i] + ")");
+    }
+    for (int i = 0; i < 20000; i++) {
+        string name = names[rng() % names.size()];
+        for (auto &c : name) {
+            if (rng() % 2) c = (char)toupper((unsigned char)c);
+        }
+        if (i % 5 == 0) name += "q";
+        auto it = expected.find(toLowerCase(name));
+        check(cityMap.find(name) == (it == expected.end() ? -1 : it->second), "find(" + name + ")");
+    }
+}
+
+// ------------------------ Handler Tests ------------------------
+
+void testBatchParsing() {
+    shared_ptr<Network> net;
+    {
+        QuietCout quiet;
+        net = loadNetwork({});
+    }
+    json response;
+    int status = runBatch(*net, R"([
+        {"src": "Delhi", "dest": "Goa", "maxStops": 4294967297},
+        {"src": " delhi", "dest": "GOA", "maxStops": "1"},
+        {"src": "Dehli", "dest": "Goa"},
+        {"src": "Goa", "dest": "goa"},
+        {"src": "Delhi", "dest": "Goa", "maxStops": 2.5},
+        7
+    ])", response);
+    const json &results = response["results"];
+    check(status == 200 && results.size() == 6, "batch status");
+    check(results[0]["status"] == 400, "maxStops 2^32 + 1 rejected");
+    check(results[1]["status"] == 200 && results[1]["fare"] == net->graph.shortest(net->cityMap.find("Delhi"), net->cityMap.find("Goa"), 1).first,
+          "resolved query answered");
+    check(results[2]["status"] == 400 && results[2]["suggestions"] == json{ "Delhi" }, "unknown city suggested");
+    check(results[3]["status"] == 400, "same city rejected");
+    check(results[4]["status"] == 400, "fractional maxStops rejected");
+    check(results[5]["status"] == 400, "non-object query rejected");
+
+    check(runBatch(*net, "[{", response) == 400, "invalid JSON");
+    check(runBatch(*net, R"({"queries": 5})", response) == 400, "queries not an array");
+    check(runBatch(*net, json(vector<json>(MAX_BATCH_QUERIES + 1, json::object())).dump(), response) == 400,
+          "too many queries");
+
+    check(boundedInt(json(3), 5) == 3 && boundedInt(json(2.5), 5) == 2, "boundedInt in range");
+    check(boundedInt(json(4294967297LL), 5) == -1 && boundedInt(json(-1), 5) == -1 &&
+          boundedInt(json(18446744073709551615ULL), 5) == -1 && boundedInt(json(1e30), 5) == -1,
+          "boundedInt out of range");
+}
+
+void testComputeExecutor() {
+    auto far = chrono::steady_clock::now() + chrono::hours(1);
+    auto settle = [](ComputeExecutor &pool, size_t completed) {
+        for (int i = 0; i < 5000; i++) {
+            json stats = pool.stats();
+            if (stats["idle"] == 2 && stats["completed"] == completed) return;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+    };
+    for (size_t limit : { 0, 1, 3 }) {
+        ComputeExecutor pool;
+        pool.start(2, limit);
+        settle(pool, 0);
+        string what = "queue limit " + to_string(limit);
+
+        // Two tasks occupy both threads, `limit` more wait, then submit refuses
+        promise<void> release;
+        shared_future<void> gate = release.get_future().share();
+        size_t accepted = 0;
+        for (size_t i = 0; i < limit + 4; i++) {
+            accepted += pool.submit([gate](bool) { gate.wait(); }, far);
+        }
+        check(accepted == limit + 2, what + ": accepted while busy");
+        release.set_value();
+        settle(pool, accepted);
+        check(pool.stats()["completed"] == accepted, what + ": accepted tasks ran");
+        check(pool.submit([](bool) {}, far), what + ": accepted once idle");
+        settle(pool, accepted + 1);
+        check(pool.stats()["completed"] == accepted + 1, what + ": ran once idle");
+    }
+}
+
+void testReloadRefusal() {
+    auto request = [](const string &addr, const vector<pair<string, string>> &headers) {
+        httplib::Request req;
+        req.remote_addr = addr;
+        for (const auto &[name, value] : headers) req.headers.emplace(name, value);
+        return req;
+    };
+    auto refused = [](const httplib::Request &req) { return reloadRefusal(req) != nullptr; };
+
+    // Without a token: loopback only, and never from a browser
+    reloadToken.clear();
+    for (string addr : { "127.0.0.1", "127.8.9.10", "::1", "::ffff:127.0.0.1" }) {
+        check(!refused(request(addr, {})), "loopback " + addr);
+        check(refused(request(addr, { { "Origin", "http://localhost:3000" } })), "browser on " + addr);
+    }
+    for (string addr : { "10.0.0.1", "192.168.1.127", "::ffff:10.0.0.1", "1270.0.0.1", "" }) {
+        check(refused(request(addr, {})), "remote '" + addr + "'");
+    }
+
+    // With a token: any address with the exact token, still never a browser
+    reloadToken = "s3cret";
+    check(!refused(request("10.0.0.1", { { "X-Reload-Token", "s3cret" } })), "remote with token");
+    check(refused(request("10.0.0.1", { { "X-Reload-Token", "s3cret" }, { "Origin", "null" } })), "browser with token");
+    for (string token : { "", "s3cre", "s3cret!", "S3cret", "s3cret\n" }) {
+        check(refused(request("127.0.0.1", { { "X-Reload-Token", token } })), "token '" + token + "'");
+    }
+    check(refused(request("127.0.0.1", {})), "loopback without the token");
+    reloadToken.clear();
+}
+
+// ------------------------ Snapshot Tests ------------------------
+
+void testSnapshot() {
+    mt19937 rng(13);
+    Network net;
+    net.graph = randomGraph(300, 3000, 9000, rng);
+    net.idToCity = randomNames(300, rng);
+    for (int i = 0; i < 300; i++) net.idToCity[i] += to_string(i);  // unique names
+    TempFile file("flightfare_test.snap");
+    QuietCout quiet;
+    writeSnapshot(net, file.path);
+
+    auto loaded = loadSnapshot(file.path);
+    const Graph &g = loaded->graph;
+    check(loaded->idToCity == net.idToCity, "round trip: names");
+    for (int c = 0; c < 300; c++) check(loaded->cityMap.find(net.idToCity[c]) == c, "round trip: lookup " + net.idToCity[c]);
+    check(g.V == net.graph.V && g.edgeCount() == net.graph.edgeCount() &&
+          equal(g.offsets, g.offsets + g.V + 1, net.graph.offsets) &&
+          equal(g.edgeTo, g.edgeTo + g.edgeCount(), net.graph.edgeTo) &&
+          equal(g.edgeCost, g.edgeCost + g.edgeCount(), net.graph.edgeCost), "round trip: edges");
+    for (int q = 0; q < 200; q++) {
+        int src = rng() % 300, dest = rng() % 300, maxStops = rng() % 6;
+        check(g.shortest(src, dest, maxStops) == net.graph.shortest(src, dest, maxStops),
+              "round trip: " + describe(src, dest, maxStops));
+    }
+    loaded.reset();
+
+    ifstream in(file.path, ios::binary);
+    const string image((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    SnapshotHeader h;
+    memcpy(&h, image.data(), sizeof(h));
+
+    // Each damaged copy must be refused without reading outside the file
+    auto rejects = [&](const string &what, string bytes) {
+        { ofstream(file.path, ios::binary | ios::trunc) << bytes; }
+        try {
+            loadSnapshot(file.path);
+            check(false, what + ": accepted");
+        } catch (const runtime_error &) {
+            check(true, what);
+        }
+    };
+    auto patched = [&](size_t at, auto value) {
+        string bytes = image;
+        memcpy(&bytes[at], &value, sizeof(value));
+        return bytes;
+    };
+    string truncated = image.substr(0, h.edgeCostAt + 8);
+    rejects("truncated", truncated);
+    rejects("truncated with its size patched", patched(offsetof(SnapshotHeader, fileSize), (uint64_t)truncated.size()).substr(0, truncated.size()));
+    rejects("header only", image.substr(0, sizeof(h)));
+    rejects("wrapping name table offset", patched(offsetof(SnapshotHeader, nameStartAt), ~uint64_t(0) - 7));
+    rejects("wrapping edge offset", patched(offsetof(SnapshotHeader, edgeCostAt), ~uint64_t(0) - 3));
+    rejects("offset past the end", patched(offsetof(SnapshotHeader, edgeToAt), (uint64_t)image.size() + 8));
+    rejects("misaligned offsets", patched(offsetof(SnapshotHeader, offsetsAt), h.offsetsAt + 1));
+    rejects("misaligned name table", patched(offsetof(SnapshotHeader, nameStartAt), h.nameStartAt + 2));
+    rejects("huge edge count", patched(offsetof(SnapshotHeader, edgeCount), uint64_t(1) << 62));
+    rejects("huge city count", patched(offsetof(SnapshotHeader, cityCount), ~uint32_t(0)));
+    rejects("names past their section", patched(h.nameStartAt + 4 * 300, ~uint32_t(0)));
+    rejects("decreasing name table", patched(h.nameStartAt + 4 * 150, ~uint32_t(0) >> 1));
+    rejects("decreasing offsets", patched(h.offsetsAt + 4 * 150, int32_t(1) << 30));
+    rejects("bad magic", patched(0, 'X'));
+}
+
+// ------------------------ Cache Tests ------------------------
+
+// SearchCache against a model with the same split (16 shards by the top four
+// bits of the key's multiplicative hash) and plain LRU lists per shard
+void testSearchCache() {
+    mt19937 rng(14);
+    for (size_t capacity : { 0, 16, 40, 160 }) {
+        SearchCache cache;
+        cache.setCapacity(capacity);
+        size_t perShard = (capacity + 15) / 16;
+        struct Entry {
+            uint64_t key, generation;
+            string body;
+        };
+        vector<list<Entry>> model(16);
+        uint64_t generation = 1;
+        string what = "capacity " + to_string(capacity);
+
+        for (int op = 0; op < 20000; op++) {
+            if (rng() % 500 == 0) generation++;  // a reload publishes a new network
+            uint64_t key = searchCacheKey(rng() % 6, rng() % 6, rng() % 3, rng() % 2, 3);
+            list<Entry> &shard = model[(key * 0x9E3779B97F4A7C15ull) >> 60];
+            auto it = find_if(shard.begin(), shard.end(), [&](const Entry &e) { return e.key == key; });
+
+            if (rng() % 2) {
+                bool expected = it != shard.end() && it->generation == generation;
+                string body = expected ? it->body : "";
+                if (expected) {
+                    shard.splice(shard.begin(), shard, it);
+                } else if (it != shard.end()) {
+                    shard.erase(it);  // stale generation, dropped on lookup
+                }
+                SearchCache::Hit hit;
+                bool found = cache.get(key, generation, hit);
+                check(found == expected, what + ": hit or miss at op " + to_string(op));
+                if (found && expected) check(*hit.body == body, what + ": body at op " + to_string(op));
+            } else {
+                // Searches that finish after a reload still store their old generation
+                uint64_t gen = generation - (generation > 1 && rng() % 4 == 0);
+                string body = to_string(op);
+                cache.put(key, gen, body, 200);
+                if (perShard == 0) continue;
+                if (it != shard.end()) shard.erase(it);
+                shard.push_front({ key, gen, body });
+                if (shard.size() > perShard) shard.pop_back();
+            }
+        }
+
+        size_t entries = 0;
+        for (const auto &shard : model) entries += shard.size();
+        json stats = cache.stats();
+        check(stats["entries"] == entries && stats["capacity"] == perShard * 16, what + ": stats");
+        check(cache.enabled() == (capacity > 0), what + ": enabled");
+        check(capacity == 0 || stats["hits"] > 100, what + ": enough hits to test");
+    }
+}
+
+// ------------------------ Loader Tests ------------------------
+
+// Loads `text` as a leg file; the error message, or "" when it loads
+string loadError(const string &text) {
+    TempFile file("flightfare_test.csv");
+    { ofstream(file.path, ios::binary) << text; }
+    try {
+        QuietCout quiet;
+        loadRoutesFile(file.path);
+        return "";
+    } catch (const runtime_error &e) {
+        return e.what();
+    }
+}
+
+void testLoadRoutesFile() {
+    mt19937 rng(15);
+    for (int round = 0; round < 4; round++) {
+        // Over 1 MB, so lines straddle read blocks; mixed spacing, CRLF,
+        // comments and one-way flags
+        char delim = round % 2 ? '\t' : ',';
+        auto names = randomNames(400, rng);
+        for (int i = 0; i < 400; i++) names[i] += to_string(i);
+        vector<tuple<int, int, int, bool>> legs;
+        vector<int> order;
+        vector<int> idOf(400, -1);
+        string text = round < 2 ? string("origin") + delim + "destination" + delim + "fare\n" : "";
+        for (int leg = 0; leg < 60000; leg++) {
+            int u = rng() % 400, v = rng() % 400, fare = rng() % 9000;
+            bool oneWay = rng() % 3 == 0;
+            if (rng() % 50 == 0) text += rng() % 2 ? "\n" : "# comment\n";
+            text += (rng() % 4 ? "" : "  ") + names[u] + delim + " " + names[v] + delim + to_string(fare);
+            if (oneWay) text += string(1, delim) + (rng() % 2 ? "yes" : "1");
+            else if (rng() % 4 == 0) text += string(1, delim) + "no";
+            text += rng() % 2 ? "\r\n" : "\n";
+            for (int c : { u, v }) {
+                if (idOf[c] < 0) {
+                    idOf[c] = order.size();
+                    order.push_back(c);
+                }
+            }
+            legs.emplace_back(idOf[u], idOf[v], fare, oneWay);
+        }
+        Graph expected(order.size());
+        for (const auto &[u, v, fare, oneWay] : legs) {
+            if (oneWay) expected.addEdge(u, v, fare);
+            else expected.addBidirectionalEdge(u, v, fare);
+        }
+        expected.freeze();
+
+        TempFile file("flightfare_test.csv");
+        { ofstream(file.path, ios::binary) << text; }
+        QuietCout quiet;
+        auto net = loadRoutesFile(file.path);
+        string what = "round " + to_string(round);
+        check(net->idToCity.size() == order.size(), what + ": city count");
+        for (size_t id = 0; id < order.size() && id < net->idToCity.size(); id++) {
+            check(net->idToCity[id] == names[order[id]], what + ": city " + to_string(id));
+        }
+        const Graph &g = net->graph;
+        check(g.V == expected.V && g.edgeCount() == expected.edgeCount() &&
+              equal(g.offsets, g.offsets + g.V + 1, expected.offsets) &&
+              equal(g.edgeTo, g.edgeTo + g.edgeCount(), expected.edgeTo) &&
+              equal(g.edgeCost, g.edgeCost + g.edgeCount(), expected.edgeCost), what + ": legs");
+    }
+
+    // Fares up to MAX_FARE load; larger ones, including ones past int, do not
+    check(loadError("A,B," + to_string(MAX_FARE) + "\n") == "", "MAX_FARE accepted");
+    for (string fare : vector<string>{ to_string(MAX_FARE + 1), "4294967396", "99999999999999999999", "-1", "12x", "", "1e3" }) {
+        string error = loadError("A,B,5\nA,C," + fare + "\n");
+        check(error.find(":2: invalid leg") != string::npos, "fare '" + fare + "' refused: " + error);
+    }
+
+    // Only line 1 may be a header; malformed lines anywhere else are errors
+    check(loadError("from,to,fare\nA,B,5\n") == "", "header on line 1");
+    check(loadError("A,B,5\nfrom,to,fare\n").find(":2: invalid leg") != string::npos, "header on line 2");
+    check(loadError("# legs\nfrom,to,fare\nA,B,5\n").find(":2: invalid leg") != string::npos, "header after a comment");
+    for (string line : { "A,B", "A", ",B,5", "A,,5", "A B 5" }) {
+        string error = loadError("A,B,5\n" + line + "\nB,C,7\n");
+        check(error.find(":2: invalid leg") != string::npos, "line '" + line + "' refused: " + error);
+    }
+}
+
+// ------------------------ Logger Tests ------------------------
+
+struct TestRecord {
+    int64_t time;
+    int thread, seq;
+
+    void format(const char *timestamp, string &out) const {
+        out += string(timestamp) + " " + to_string(thread) + " " + to_string(seq) + "\n";
+    }
+};
+
+void testAsyncLogger() {
+    for (int round = 0; round < 20; round++) {
+        TempFile file("flightfare_test.log");
+        const int THREADS = 4, RECORDS = 2500;  // below the ring size, so none drop
+        {
+            AsyncLogger<TestRecord> logger;
+            logger.start(fopen(file.path.c_str(), "w"));
+            vector<thread> writers;
+            for (int t = 0; t < THREADS; t++) {
+                writers.emplace_back([&logger, t] {
+                    for (int i = 0; i < RECORDS; i++) logger.log({ epochSeconds(), t, i });
+                });
+            }
+            for (auto &w : writers) w.join();
+            if (round % 2) logger.stop();  // otherwise the destructor stops it
+        }
+
+        // Every record is written by the time stop() returns, each thread's in order
+        ifstream in(file.path);
+        vector<int> next(THREADS, 0);
+        string day, clock;
+        int t, seq, lines = 0, misplaced = 0;
+        while (in >> day >> clock >> t >> seq) {
+            lines++;
+            misplaced += t < 0 || t >= THREADS || seq != next[t]++;
+        }
+        string what = "round " + to_string(round);
+        check(lines == THREADS * RECORDS, what + ": " + to_string(lines) + " lines written");
+        check(misplaced == 0, what + ": records in order");
+    }
+}
+
+int main() {
+    runTest("Graph::shortest matches brute force", testShortestBruteForce);
+    runTest("Graph::shortest matches a full Bellman-Ford", testShortestFullScan);
+    runTest("findMultipleRoutes matches brute force", testMultipleRoutes);
+    runTest("shortestToMany and searchBatch match shortest", testShortestToMany);
+    runTest("faresFrom matches shortest for every city", testFaresFrom);
+    runTest("FareTable::route matches shortest", testFareTable);
+    runTest("parallelFor runs every item exactly once", testParallelFor);
+    runTest("levenshtein matches the DP matrix", testLevenshtein);
+    runTest("SuggestionIndex matches a linear scan", testSuggestions);
+    runTest("AutocompleteIndex matches a linear scan", testAutocomplete);
+    runTest("SuggestionIndex with aliases matches a linear scan", testAliasSuggestions);
+    runTest("CityMap matches a lowercased map", testCityMap);
+    runTest("runBatch validates each query", testBatchParsing);
+    runTest("ComputeExecutor queues only beyond idle threads", testComputeExecutor);
+    runTest("reloadRefusal admits only trusted clients", testReloadRefusal);
+    runTest("Snapshots round-trip and refuse damaged files", testSnapshot);
+    runTest("SearchCache matches an LRU model per shard", testSearchCache);
+    runTest("loadRoutesFile parses legs and refuses bad lines", testLoadRoutesFile);
+    runTest("AsyncLogger writes every record before stopping", testAsyncLogger);
+
+    cout << "\n" << checkCount - failureCount << " of " << checkCount << " checks passed" << endl;
+    return failureCount == 0 ? 0 : 1;
+}